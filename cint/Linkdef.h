@@ -41,6 +41,8 @@
 #pragma link C++ defined_in ../src/Vme.hxx;
 #pragma link C++ defined_in ../src/Dragon.hxx;
 #pragma link C++ defined_in ../src/Sonik.hxx;
+#pragma link C++ defined_in ../src/EpicsSeries.hxx;
+#pragma link C++ defined_in ../src/ScalerIndex.hxx;
 #pragma link C++ defined_in ../src/utils/VariableStructs.hxx;
 
 #pragma link C++ defined_in ../src/TStamp.hxx;
@@ -83,6 +85,7 @@ class TTree;
 
 #pragma link C++ class midas::Event::Header+;
 #pragma link C++ class midas::Xml+;
+#pragma link C++ class midas::OdbTable+;
 #pragma link C++ class midas::Odb+;
 #pragma link C++ class midas::Database+;
 #pragma link C++ class mxml_struct+;
@@ -110,6 +113,7 @@ class TTree;
 // dragon ns free functions
 #pragma link C++ function dragon::MakeChains;
 #pragma link C++ function dragon::OpenRun;
+#pragma link C++ function dragon::FriendCoinc;
 
 #pragma link C++ function dragon::MeasurementWeightedAverage(std::vector<UDouble_t>::iterator, std::vector<UDouble_t>::iterator);
 #pragma link C++ function dragon::MeasurementWeightedAverage(UDouble_t*, UDouble_t*);
@@ -131,8 +135,11 @@ class TTree;
 #pragma link C++ class dragon::Head+;
 #pragma link C++ class dragon::Tail+;
 #pragma link C++ class dragon::Coinc+;
+#pragma link C++ class dragon::CoincLink+;
 #pragma link C++ class dragon::Scaler+;
 #pragma link C++ class dragon::Epics+;
+#pragma link C++ class dragon::EpicsSeries+;
+#pragma link C++ class dragon::ScalerIndex+;
 #pragma link C++ class dragon::Unpacker+;
 #pragma link C++ class dragon::Kin2Body+;
 #pragma link C++ class dragon::LinearFitter+;
@@ -166,6 +173,7 @@ class TTree;
 #pragma link C++ class midas::CoincEvent+;
 #pragma link C++ class midas::Odb+;
 #pragma link C++ class midas::Xml+;
+#pragma link C++ class midas::OdbTable+;
 #pragma link C++ class mxml_struct+;
 
 // tstamp ns classes
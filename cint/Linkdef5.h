@@ -38,6 +38,8 @@
 #pragma link C++ class vme::V1190::Channel+;
 #pragma link C++ defined_in ../src/Dragon.hxx;
 #pragma link C++ defined_in ../src/Sonik.hxx;
+#pragma link C++ defined_in ../src/EpicsSeries.hxx;
+#pragma link C++ defined_in ../src/ScalerIndex.hxx;
 #pragma link C++ defined_in ../src/utils/VariableStructs.hxx;
 
 class TH1;
@@ -49,6 +51,7 @@ class TTree;
 #pragma link C++ class midas::Event::Header+;
 
 #pragma link C++ class midas::Xml+;
+#pragma link C++ class midas::OdbTable+;
 #pragma link C++ class midas::Odb+;
 #pragma link C++ class midas::Database+;
 #pragma link C++ class mxml_struct+;
@@ -0,0 +1,459 @@
+///
+/// \file Batch.cxx
+/// \author G. Christian
+/// \brief Implements Batch.hxx
+///
+#include <algorithm>
+#include "utils/Functions.hxx"
+#include "utils/Valid.hxx"
+#include "Vme.hxx"
+#include "Batch.hxx"
+
+namespace dutils = dragon::utils;
+namespace dbatch = dragon::batch;
+
+
+// ================ Column kernels ================ //
+
+namespace {
+
+const double kNoData = dragon::NoData<double>::value();
+
+/// Pedestal subtract, zero suppress & linear calibrate one channel for all events
+/*! Same sequence of operations as pedestal_subtract(), zero_suppress1() and
+ *  linear_calibrate(), written as selects so the loop vectorizes. */
+inline void adc_column(double* x, int n, double pedestal, double threshold, double offset, double slope)
+{
+	for(int i=0; i< n; ++i) {
+		double v = x[i];
+		v = v != kNoData ? v - pedestal : v;
+		v = v != kNoData && v < threshold ? 0. : v;
+		x[i] = v != kNoData ? offset + v * slope : v;
+	}
+}
+
+/// Linear calibrate one channel for all events
+inline void linear_column(double* x, int n, double offset, double slope)
+{
+	for(int i=0; i< n; ++i) {
+		const double v = x[i];
+		x[i] = v != kNoData ? offset + v * slope : v;
+	}
+}
+
+/// Add the valid values of one channel to a running per-event sum
+inline void sum_column(double* sum, char* any, const double* x, int n)
+{
+	for(int i=0; i< n; ++i) {
+		const bool valid = x[i] != kNoData;
+		sum[i] += valid ? x[i] : 0.;
+		any[i] |= valid;
+	}
+}
+
+/// Per-event std::max_element() over channels [first, last)
+/*! Keeps the first maximum, like std::max_element(); `any` flags events with at
+ *  least one valid channel in the range. */
+inline void max_columns(const dbatch::Block& x, int first, int last, double* best, uint32_t* which, char* any)
+{
+	const int n = x.size();
+	const double* x0 = x[first];
+	for(int i=0; i< n; ++i) {
+		best[i]  = x0[i];
+		which[i] = first;
+		any[i]   = x0[i] != kNoData;
+	}
+	for(int ch = first+1; ch < last; ++ch) {
+		const double* xc = x[ch];
+		for(int i=0; i< n; ++i) {
+			const bool larger = best[i] < xc[i];
+			best[i]  = larger ? xc[i] : best[i];
+			which[i] = larger ? ch : which[i];
+			any[i]  |= xc[i] != kNoData;
+		}
+	}
+}
+
+/// Channel map one module into event `evt` of a block
+template <class M>
+inline void channel_map_column(dbatch::Block& out, int evt, int numch, const int* channels, const M& module)
+{
+	for(int ch = 0; ch < numch; ++ch)
+		out[ch][evt] = module.get_data(channels[ch]);
+}
+
+/// Channel map an array of modules into event `evt` of a block
+template <class M>
+inline void channel_map_column(dbatch::Block& out, int evt, int numch, const int* channels, const int* modules, const M* moduleArr)
+{
+	for(int ch = 0; ch < numch; ++ch)
+		out[ch][evt] = moduleArr[ modules[ch] ].get_data(channels[ch]);
+}
+
+template <class T>
+inline void reset_vector(std::vector<T>& v, int n)
+{
+	v.assign(n, dragon::NoData<T>::value());
+}
+
+} // namespace
+
+
+// ================ Class dragon::batch::Block ================ //
+
+dbatch::Block::Block(int nch, int nevt):
+	fNumChannels(nch), fNumEvents(0)
+{
+	/// ::
+	resize(nevt);
+}
+
+void dbatch::Block::resize(int nevt)
+{
+	/// ::
+	fNumEvents = nevt;
+	fData.assign(fNumChannels * fNumEvents + 1, kNoData); // +1: keeps &fData[0] valid when empty
+}
+
+void dbatch::Block::reset()
+{
+	/// ::
+	std::fill(fData.begin(), fData.end(), kNoData);
+}
+
+void dbatch::Block::get(int evt, double* out) const
+{
+	/// ::
+	for(int ch = 0; ch < fNumChannels; ++ch)
+		out[ch] = (*this)[ch][evt];
+}
+
+void dbatch::Block::set(int evt, const double* in)
+{
+	/// ::
+	for(int ch = 0; ch < fNumChannels; ++ch)
+		(*this)[ch][evt] = in[ch];
+}
+
+
+// ================ Class dragon::batch::BgoBlock ================ //
+
+dbatch::BgoBlock::BgoBlock(int nevt):
+	ecal(MAX_CHANNELS), tcal(MAX_CHANNELS), esort(MAX_CHANNELS), variables()
+{
+	/// ::
+	resize(nevt);
+}
+
+void dbatch::BgoBlock::resize(int nevt)
+{
+	/// ::
+	ecal.resize(nevt);
+	tcal.resize(nevt);
+	esort.resize(nevt);
+	reset_vector(sum, nevt);
+	reset_vector(hit0, nevt);
+	reset_vector(x0, nevt);
+	reset_vector(y0, nevt);
+	reset_vector(z0, nevt);
+	reset_vector(t0, nevt);
+}
+
+void dbatch::BgoBlock::reset()
+{
+	/// ::
+	resize(size());
+}
+
+void dbatch::BgoBlock::read_data(int evt, const vme::V792& adc, const vme::V1190& tdc)
+{
+	/// ::
+	channel_map_column(ecal, evt, MAX_CHANNELS, variables.adc.channel, adc);
+	channel_map_column(tcal, evt, MAX_CHANNELS, variables.tdc.channel, tdc);
+}
+
+void dbatch::BgoBlock::load(int evt, const dragon::Bgo& bgo)
+{
+	/// ::
+	ecal.set(evt, bgo.ecal);
+	tcal.set(evt, bgo.tcal);
+}
+
+void dbatch::BgoBlock::calculate()
+{
+	/*!
+	 * Same steps as dragon::Bgo::calculate(). The calibrations and the energy sum
+	 * loop over events for each channel; the energy sort is done event-by-event
+	 * with the same index_sort_k() call as the scalar version.
+	 */
+	const int n = size();
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch) {
+		adc_column(ecal[ch], n, variables.adc.pedestal[ch], 10., variables.adc.offset[ch], variables.adc.slope[ch]);
+		linear_column(tcal[ch], n, variables.tdc.offset[ch], variables.tdc.slope[ch]);
+	}
+
+	std::vector<char> any(n, 0);
+	std::fill(sum.begin(), sum.end(), 0.);
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		sum_column(&sum[0], &any[0], ecal[ch], n);
+
+	const int nsort = variables.nsort < MAX_CHANNELS ? std::max(variables.nsort, 1) : MAX_CHANNELS;
+	double e[MAX_CHANNELS], es[MAX_CHANNELS];
+	int isort[MAX_CHANNELS];
+	for(int evt = 0; evt < n; ++evt) {
+		ecal.get(evt, e);
+		dutils::reset_array(MAX_CHANNELS, es);
+		dutils::index_sort_k(e, e+MAX_CHANNELS, isort, nsort, dutils::greater_and_valid<double>());
+		dutils::channel_map_from_array(es, nsort, isort, e);
+		esort.set(evt, es);
+
+		if(dutils::is_valid(es[0])) {
+			hit0[evt] = isort[0];
+			x0[evt] = variables.pos.x[ isort[0] ];
+			y0[evt] = variables.pos.y[ isort[0] ];
+			z0[evt] = variables.pos.z[ isort[0] ];
+			t0[evt] = tcal[ isort[0] ][evt];
+		}
+		else {
+			sum[evt] = kNoData;
+		}
+	}
+}
+
+void dbatch::BgoBlock::store(int evt, dragon::Bgo& bgo) const
+{
+	/// ::
+	ecal.get(evt, bgo.ecal);
+	tcal.get(evt, bgo.tcal);
+	esort.get(evt, bgo.esort);
+	bgo.sum  = sum[evt];
+	bgo.hit0 = hit0[evt];
+	bgo.x0   = x0[evt];
+	bgo.y0   = y0[evt];
+	bgo.z0   = z0[evt];
+	bgo.t0   = t0[evt];
+}
+
+
+// ================ Class dragon::batch::DsssdBlock ================ //
+
+dbatch::DsssdBlock::DsssdBlock(int nevt):
+	ecal(MAX_CHANNELS), variables()
+{
+	/// ::
+	resize(nevt);
+}
+
+void dbatch::DsssdBlock::resize(int nevt)
+{
+	/// ::
+	ecal.resize(nevt);
+	reset_vector(efront, nevt);
+	reset_vector(eback, nevt);
+	reset_vector(hit_front, nevt);
+	reset_vector(hit_back, nevt);
+	reset_vector(tfront, nevt);
+	reset_vector(tback, nevt);
+}
+
+void dbatch::DsssdBlock::reset()
+{
+	/// ::
+	resize(size());
+}
+
+void dbatch::DsssdBlock::read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc)
+{
+	/// ::
+	channel_map_column(ecal, evt, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	dutils::channel_map(tfront[evt], variables.tdc_front.channel, tdc);
+	dutils::channel_map(tback[evt],  variables.tdc_back.channel,  tdc);
+}
+
+void dbatch::DsssdBlock::load(int evt, const dragon::Dsssd& dsssd)
+{
+	/// ::
+	ecal.set(evt, dsssd.ecal);
+	tfront[evt] = dsssd.tfront;
+	tback[evt]  = dsssd.tback;
+}
+
+void dbatch::DsssdBlock::calculate()
+{
+	/*!
+	 * Same steps as dragon::Dsssd::calculate(); the front/back maxima are
+	 * found with a running per-event comparison that matches std::max_element().
+	 */
+	const int n = size();
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		linear_column(ecal[ch], n, variables.adc.offset[ch], variables.adc.slope[ch]);
+	linear_column(&tfront[0], n, variables.tdc_front.offset, variables.tdc_front.slope);
+	linear_column(&tback[0],  n, variables.tdc_back.offset,  variables.tdc_back.slope);
+
+	std::vector<char> anyFront(n), anyBack(n);
+	max_columns(ecal, 0,  16, &efront[0], &hit_front[0], &anyFront[0]);
+	max_columns(ecal, 16, 32, &eback[0],  &hit_back[0],  &anyBack[0]);
+
+	for(int evt = 0; evt < n; ++evt) {
+		if(!anyFront[evt]) dutils::reset_data(efront[evt], hit_front[evt]);
+		if(!anyBack[evt])  dutils::reset_data(eback[evt],  hit_back[evt]);
+	}
+}
+
+void dbatch::DsssdBlock::store(int evt, dragon::Dsssd& dsssd) const
+{
+	/// ::
+	ecal.get(evt, dsssd.ecal);
+	dsssd.efront    = efront[evt];
+	dsssd.eback     = eback[evt];
+	dsssd.hit_front = hit_front[evt];
+	dsssd.hit_back  = hit_back[evt];
+	dsssd.tfront    = tfront[evt];
+	dsssd.tback     = tback[evt];
+}
+
+
+// ================ Class dragon::batch::IonChamberBlock ================ //
+
+dbatch::IonChamberBlock::IonChamberBlock(int nevt):
+	anode(MAX_CHANNELS), tcal(MAX_TDC), variables()
+{
+	/// ::
+	resize(nevt);
+}
+
+void dbatch::IonChamberBlock::resize(int nevt)
+{
+	/// ::
+	anode.resize(nevt);
+	tcal.resize(nevt);
+	reset_vector(sum, nevt);
+}
+
+void dbatch::IonChamberBlock::reset()
+{
+	/// ::
+	resize(size());
+}
+
+void dbatch::IonChamberBlock::read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc)
+{
+	/// ::
+	channel_map_column(anode, evt, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	channel_map_column(tcal, evt, MAX_TDC, variables.tdc.channel, tdc);
+}
+
+void dbatch::IonChamberBlock::load(int evt, const dragon::IonChamber& ic)
+{
+	/// ::
+	anode.set(evt, ic.anode);
+	tcal.set(evt, ic.tcal);
+}
+
+void dbatch::IonChamberBlock::calculate()
+{
+	/*!
+	 * Same steps as dragon::IonChamber::calculate()
+	 */
+	const int n = size();
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		linear_column(anode[ch], n, variables.adc.offset[ch], variables.adc.slope[ch]);
+	for(int ch = 0; ch < MAX_TDC; ++ch)
+		linear_column(tcal[ch], n, variables.tdc.offset[ch], variables.tdc.slope[ch]);
+
+	std::vector<char> any(n, 0);
+	std::fill(sum.begin(), sum.end(), 0.);
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		sum_column(&sum[0], &any[0], anode[ch], n);
+	for(int evt = 0; evt < n; ++evt)
+		if(!any[evt]) sum[evt] = kNoData;
+}
+
+void dbatch::IonChamberBlock::store(int evt, dragon::IonChamber& ic) const
+{
+	/// ::
+	anode.get(evt, ic.anode);
+	tcal.get(evt, ic.tcal);
+	ic.sum = sum[evt];
+}
+
+
+// ================ Class dragon::batch::McpBlock ================ //
+
+dbatch::McpBlock::McpBlock(int nevt):
+	anode(MAX_CHANNELS), tcal(NUM_DETECTORS), variables()
+{
+	/// ::
+	resize(nevt);
+}
+
+void dbatch::McpBlock::resize(int nevt)
+{
+	/// ::
+	anode.resize(nevt);
+	tcal.resize(nevt);
+	reset_vector(esum, nevt);
+	reset_vector(tac, nevt);
+	reset_vector(x, nevt);
+	reset_vector(y, nevt);
+}
+
+void dbatch::McpBlock::reset()
+{
+	/// ::
+	resize(size());
+}
+
+void dbatch::McpBlock::read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc)
+{
+	/// ::
+	channel_map_column(anode, evt, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	channel_map_column(tcal, evt, NUM_DETECTORS, variables.tdc.channel, tdc);
+	dutils::channel_map(tac[evt], variables.tac_adc.channel, variables.tac_adc.module, adcs);
+}
+
+void dbatch::McpBlock::load(int evt, const dragon::Mcp& mcp)
+{
+	/// ::
+	anode.set(evt, mcp.anode);
+	tcal.set(evt, mcp.tcal);
+	tac[evt] = mcp.tac;
+}
+
+void dbatch::McpBlock::calculate()
+{
+	/*!
+	 * Same steps as dragon::Mcp::calculate()
+	 */
+	const int n = size();
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		linear_column(anode[ch], n, variables.adc.offset[ch], variables.adc.slope[ch]);
+	for(int ch = 0; ch < NUM_DETECTORS; ++ch)
+		linear_column(tcal[ch], n, variables.tdc.offset[ch], variables.tdc.slope[ch]);
+	linear_column(&tac[0], n, variables.tac_adc.offset, variables.tac_adc.slope);
+
+	const double Lhalf = 25.;  // half the length of a single side of the MCP (50/2 [mm])
+	const double* a0 = anode[0];
+	const double* a1 = anode[1];
+	const double* a2 = anode[2];
+	const double* a3 = anode[3];
+	for(int evt = 0; evt < n; ++evt) {
+		const bool valid = a0[evt] != kNoData && a1[evt] != kNoData && a2[evt] != kNoData && a3[evt] != kNoData;
+		const double sum = ((0. + a0[evt]) + a1[evt] + a2[evt]) + a3[evt];
+		if(valid && sum != 0) {
+			x[evt] = Lhalf * ( (a1[evt] + a2[evt]) - (a0[evt] + a3[evt]) ) / sum;
+			y[evt] = Lhalf * ( (a0[evt] + a1[evt]) - (a2[evt] + a3[evt]) ) / sum;
+		}
+	}
+}
+
+void dbatch::McpBlock::store(int evt, dragon::Mcp& mcp) const
+{
+	/// ::
+	anode.get(evt, mcp.anode);
+	tcal.get(evt, mcp.tcal);
+	mcp.esum = esum[evt];
+	mcp.tac  = tac[evt];
+	mcp.x    = x[evt];
+	mcp.y    = y[evt];
+}
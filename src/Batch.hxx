@@ -0,0 +1,243 @@
+///
+/// \file Batch.hxx
+/// \author G. Christian
+/// \brief Defines structure-of-arrays batch versions of the detector calculations
+/// \details The detector classes in Dragon.hxx process one event at a time, on
+///  per-event arrays of channels. The classes here hold the same quantities for a
+///  block of events, stored channel-major (all events of channel 0, then all
+///  events of channel 1, ...), so that the calibration and derived-quantity loops
+///  run over events with unit stride and can be vectorized by the compiler.
+///  They are meant as the inner engine for offline reprocessing (as in
+///  dragon::DsssdCalibrate); results are identical to calling the scalar
+///  calculate() on each event, as checked by test/batchtest.cxx.
+///
+#ifndef HAVE_DRAGON_BATCH_HXX
+#define HAVE_DRAGON_BATCH_HXX
+#include <vector>
+#include "Dragon.hxx"
+
+#ifndef __MAKECINT__
+
+namespace dragon {
+
+/// Encloses structure-of-arrays (batch) detector calculations
+namespace batch {
+
+///
+/// Channel-major block of `double` values for many events
+///
+class Block {
+public: // Methods
+	/// Construct with `nch` channels and room for `nevt` events
+	Block(int nch = 0, int nevt = 0);
+	/// Change the number of events and reset all values to NoData
+	void resize(int nevt);
+	/// Set all values to NoData
+	void reset();
+	/// Number of channels
+	int channels() const { return fNumChannels; }
+	/// Number of events
+	int size() const { return fNumEvents; }
+	/// Pointer to the (contiguous) values of channel `ch`, one per event
+	double* operator[] (int ch) { return &fData[0] + ch*fNumEvents; }
+	/// Pointer to the (contiguous) values of channel `ch`, one per event
+	const double* operator[] (int ch) const { return &fData[0] + ch*fNumEvents; }
+	/// Gather the values of event `evt` into a plain per-channel array
+	void get(int evt, double* out) const;
+	/// Scatter a plain per-channel array into event `evt`
+	void set(int evt, const double* in);
+
+private: // Data
+	/// Number of channels
+	int fNumChannels;
+	/// Number of events
+	int fNumEvents;
+	/// Values, `fData[ch*fNumEvents + evt]`
+	std::vector<double> fData;
+};
+
+///
+/// Batch version of dragon::Bgo
+///
+class BgoBlock {
+public: // Constants
+	/// Number of channels in the BGO array
+	static const int MAX_CHANNELS = dragon::Bgo::MAX_CHANNELS;
+
+public: // Methods
+	/// Construct with room for `nevt` events
+	BgoBlock(int nevt = 0);
+	/// Change the number of events and reset all data to NoData
+	void resize(int nevt);
+	/// Sets all data values to NoData
+	void reset();
+	/// Number of events in the block
+	int size() const { return ecal.size(); }
+	/// Read adc & tdc data for event `evt`
+	void read_data(int evt, const vme::V792& adc, const vme::V1190& tdc);
+	/// Copy raw (post read_data(), pre calculate()) values of a Bgo into event `evt`
+	void load(int evt, const dragon::Bgo& bgo);
+	/// Do higher-level parameter calculations for all events in the block
+	void calculate();
+	/// Copy the results for event `evt` into a Bgo
+	void store(int evt, dragon::Bgo& bgo) const;
+
+public: // Data
+	/// Calibrated energies
+	Block ecal;
+	/// Calibrated times
+	Block tcal;
+	/// Sorted (high->low) energies
+	Block esort;
+	/// Sum of all valid energies
+	std::vector<double> sum;
+	/// Which detector was the highest energy hit
+	std::vector<int> hit0;
+	/// x position of the highest energy hit
+	std::vector<double> x0;
+	/// y position of the highest energy hit
+	std::vector<double> y0;
+	/// z position of the highest energy hit
+	std::vector<double> z0;
+	/// Time of the highest energy hit
+	std::vector<double> t0;
+	/// Variables (shared by all events in the block)
+	dragon::Bgo::Variables variables;
+};
+
+///
+/// Batch version of dragon::Dsssd
+///
+class DsssdBlock {
+public: // Constants
+	/// Number of channels
+	static const int MAX_CHANNELS = dragon::Dsssd::MAX_CHANNELS;
+
+public: // Methods
+	/// Construct with room for `nevt` events
+	DsssdBlock(int nevt = 0);
+	/// Change the number of events and reset all data to NoData
+	void resize(int nevt);
+	/// Sets all data values to NoData
+	void reset();
+	/// Number of events in the block
+	int size() const { return ecal.size(); }
+	/// Read adc & tdc data for event `evt`
+	void read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc);
+	/// Copy raw values of a Dsssd into event `evt`
+	void load(int evt, const dragon::Dsssd& dsssd);
+	/// Perform energy and time calibrations, front/back maxima
+	void calculate();
+	/// Copy the results for event `evt` into a Dsssd
+	void store(int evt, dragon::Dsssd& dsssd) const;
+
+public: // Data
+	/// Calibrated energy signals
+	Block ecal;
+	/// Highest energy signal in the front strips (0 - 15)
+	std::vector<double> efront;
+	/// Highest energy signal in the back strips (16 - 31)
+	std::vector<double> eback;
+	/// Which strip was hit in the front strips
+	std::vector<uint32_t> hit_front;
+	/// Which strip was hit in the back strips
+	std::vector<uint32_t> hit_back;
+	/// Calibrated time signal from the front strips
+	std::vector<double> tfront;
+	/// Calibrated time signal from the back strips
+	std::vector<double> tback;
+	/// Variables (shared by all events in the block)
+	dragon::Dsssd::Variables variables;
+};
+
+///
+/// Batch version of dragon::IonChamber
+///
+class IonChamberBlock {
+public: // Constants
+	/// Number of anodes
+	static const int MAX_CHANNELS = dragon::IonChamber::MAX_CHANNELS;
+	/// Number of time signals
+	static const int MAX_TDC = dragon::IonChamber::MAX_TDC;
+
+public: // Methods
+	/// Construct with room for `nevt` events
+	IonChamberBlock(int nevt = 0);
+	/// Change the number of events and reset all data to NoData
+	void resize(int nevt);
+	/// Sets all data values to NoData
+	void reset();
+	/// Number of events in the block
+	int size() const { return anode.size(); }
+	/// Read adc & tdc data for event `evt`
+	void read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc);
+	/// Copy raw values of an IonChamber into event `evt`
+	void load(int evt, const dragon::IonChamber& ic);
+	/// Calibrate anode and time signals, calculate anode sum
+	void calculate();
+	/// Copy the results for event `evt` into an IonChamber
+	void store(int evt, dragon::IonChamber& ic) const;
+
+public: // Data
+	/// Calibrated anode signals
+	Block anode;
+	/// Time signals
+	Block tcal;
+	/// Sum of anode signals
+	std::vector<double> sum;
+	/// Variables (shared by all events in the block)
+	dragon::IonChamber::Variables variables;
+};
+
+///
+/// Batch version of dragon::Mcp
+///
+class McpBlock {
+public: // Constants
+	/// Number of anodes on MCP0
+	static const int MAX_CHANNELS = dragon::Mcp::MAX_CHANNELS;
+	/// Number of separate mcp detctors
+	static const int NUM_DETECTORS = dragon::Mcp::NUM_DETECTORS;
+
+public: // Methods
+	/// Construct with room for `nevt` events
+	McpBlock(int nevt = 0);
+	/// Change the number of events and reset all data to NoData
+	void resize(int nevt);
+	/// Sets all data values to NoData
+	void reset();
+	/// Number of events in the block
+	int size() const { return anode.size(); }
+	/// Read adc & tdc data for event `evt`
+	void read_data(int evt, const vme::V785 adcs[], const vme::V1190& tdc);
+	/// Copy raw values of an Mcp into event `evt`
+	void load(int evt, const dragon::Mcp& mcp);
+	/// Calibrate ADC/TDC signals, calculate x and y positions
+	void calculate();
+	/// Copy the results for event `evt` into an Mcp
+	void store(int evt, dragon::Mcp& mcp) const;
+
+public: // Data
+	/// Anode signals
+	Block anode;
+	/// TDC signals
+	Block tcal;
+	/// Sum of anode signals
+	std::vector<double> esum;
+	/// TAC signal (MCP_TOF).
+	std::vector<double> tac;
+	/// x-position
+	std::vector<double> x;
+	/// y-position
+	std::vector<double> y;
+	/// Variables (shared by all events in the block)
+	dragon::Mcp::Variables variables;
+};
+
+} // namespace batch
+
+} // namespace dragon
+
+#endif // #ifndef __MAKECINT__
+
+#endif // #ifndef HAVE_DRAGON_BATCH_HXX
@@ -4,6 +4,9 @@
 /// \brief Implements Dragon.hxx
 ///
 #include <string>
+#include <cctype>
+#include <cstring>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include "midas/Database.hxx"
@@ -152,6 +155,144 @@ bool dragon::RunParameters::read_data(const midas::Database* db)
 }
 
 
+// ==================== Derived quantities ==================== //
+
+namespace {
+
+/// Declaration of a derived quantity: its inputs and the fields it fills
+struct DerivedInfo {
+	/// Quantity bit
+	uint32_t fQuantity;
+	/// Other derived quantities it is calculated from
+	uint32_t fInputs;
+	/// Field names (as they appear in parameter expressions), NULL terminated
+	const char* fFields[8];
+};
+
+const DerivedInfo gDerivedInfo[] = {
+	{ dragon::derived::BGO_SORT,  0,
+		{ "bgo.esort", 0 } },
+	{ dragon::derived::BGO_HIT,   dragon::derived::BGO_SORT,
+		{ "bgo.sum", "bgo.hit0", "bgo.x0", "bgo.y0", "bgo.z0", "bgo.t0", 0 } },
+	{ dragon::derived::MCP_POS,   0,
+		{ "mcp.x", "mcp.y", 0 } },
+	{ dragon::derived::HI_TOF,    0,
+		{ "tof.", 0 } },
+	{ dragon::derived::COINC_TOF, 0,
+		{ "xtrig", "xtofh", "xtoft", 0 } }
+};
+
+const int gNumDerived = sizeof(gDerivedInfo) / sizeof(gDerivedInfo[0]);
+
+inline bool is_identifier_char(char c)
+{
+	return isalnum(c) || c == '_';
+}
+
+/// Check if `field` appears in `expression` as a complete name
+bool references(const std::string& expression, const std::string& field)
+{
+	for(size_t pos = expression.find(field); pos != std::string::npos; pos = expression.find(field, pos + 1)) {
+		const size_t end = pos + field.size();
+		if(pos > 0 && is_identifier_char(expression[pos-1]))
+			continue;
+		if(field[field.size()-1] != '.' && end < expression.size() && is_identifier_char(expression[end]))
+			continue;
+		return true;
+	}
+	return false;
+}
+
+} // namespace
+
+uint32_t dragon::derived::resolve(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of Quantity_t values
+	 * \returns \e mask plus, recursively, the inputs of every quantity in it
+	 */
+	mask &= ALL;
+	uint32_t previous;
+	do {
+		previous = mask;
+		for(int i=0; i< gNumDerived; ++i) {
+			if(mask & gDerivedInfo[i].fQuantity)
+				mask |= gDerivedInfo[i].fInputs;
+		}
+	} while (mask != previous);
+
+	return mask;
+}
+
+uint32_t dragon::derived::from_expression(const std::string& expression)
+{
+	/*!
+	 * \param expression Parameter expression, e.g. `rootana::gHead.bgo.esort[0]`
+	 * or `coinc.tail.tof.mcp`
+	 * \returns Mask of the derived quantities whose fields appear in \e expression
+	 * (not resolved)
+	 */
+	uint32_t mask = 0;
+	for(int i=0; i< gNumDerived; ++i) {
+		for(const char* const* field = gDerivedInfo[i].fFields; *field; ++field) {
+			if(references(expression, *field)) {
+				mask |= gDerivedInfo[i].fQuantity;
+				break;
+			}
+		}
+	}
+
+	return mask;
+}
+
+
+// ==================== Dirty-tracking reset checks ==================== //
+
+#ifdef DRAGON_DEBUG_RESET
+namespace {
+
+/// Size of the data part of a detector (everything before its variables)
+template <class T>
+size_t data_size(const T& t)
+{
+	return reinterpret_cast<const char*>(&t.variables) - reinterpret_cast<const char*>(&t);
+}
+
+/// Report a component which differs from a full reset
+void report_reset(const char* where, const char* component)
+{
+	dutils::Error(where, __FILE__, __LINE__)
+		<< "Dirty-tracking reset left \"" << component << "\" different from a full reset. "
+		<< "Is something writing to it without calling mark_dirty()?";
+}
+
+/// Check that the first \e len bytes of a component are the same as after calling its reset()
+/*!
+ * The reference is a raw copy of \e t, reset in place, so padding bytes
+ * compare equal. Only meant for debugging, on components whose reset()
+ * does not touch anything but plain data.
+ */
+template <class T>
+void check_reset(const char* where, const char* component, const T& t, size_t len = sizeof(T))
+{
+	std::vector<double> buf(sizeof(T) / sizeof(double) + 1);
+	memcpy(&buf[0], &t, sizeof(T));
+	reinterpret_cast<T*>(&buf[0])->reset();
+	if(memcmp(&buf[0], &t, len) != 0) report_reset(where, component);
+}
+
+/// Check that a single value is the same as after a reset
+void check_reset(const char* where, const char* component, double t)
+{
+	double ref = t;
+	dutils::reset_data(ref);
+	if(memcmp(&ref, &t, sizeof(double)) != 0) report_reset(where, component);
+}
+
+} // namespace
+#endif
+
+
 // ==================== Class dragon::Bgo ==================== //
 
 dragon::Bgo::Bgo():
@@ -181,26 +322,32 @@ void dragon::Bgo::read_data(const vme::V792& adc, const vme::V1190& tdc)
 	dutils::channel_map(tcal, MAX_CHANNELS, variables.tdc.channel, tdc);
 }
 
-void dragon::Bgo::calculate()
+void dragon::Bgo::calculate(uint32_t derived)
 {
 	/*!
+	 * \param derived Resolved mask of dragon::derived quantities to calculate
+	 *
 	 * Does the following:
 	 */
 	/// - Pedestal subtract, zero suppress and calibrate energy values
 	dutils::pedestal_subtract(ecal, MAX_CHANNELS, variables.adc);
-	dutils::zero_suppress1(ecal, MAX_CHANNELS, 10.);
+	dutils::zero_suppress1<MAX_CHANNELS>(ecal, 10.);
 	dutils::linear_calibrate(ecal, MAX_CHANNELS, variables.adc);
 
 	/// - Calibrate time values
 	dutils::linear_calibrate(tcal, MAX_CHANNELS, variables.tdc);
 
+	if(!(derived & dragon::derived::BGO_SORT)) return;
+
 	/// - Calculate descending-order energy indices and map into \c esort[]
+	///   (only the first variables.nsort of them, unless all are requested)
 	int isort[MAX_CHANNELS];
-	dutils::index_sort(ecal, ecal+MAX_CHANNELS, isort, dutils::greater_and_valid<double>());
-	dutils::channel_map_from_array(esort, MAX_CHANNELS, isort, ecal);
+	const int nsort = variables.nsort < MAX_CHANNELS ? std::max(variables.nsort, 1) : MAX_CHANNELS;
+	dutils::index_sort_k(ecal, ecal+MAX_CHANNELS, isort, nsort, dutils::greater_and_valid<double>());
+	dutils::channel_map_from_array(esort, nsort, isort, ecal);
 
 	/// - If we have at least one good hit, calculate sum, x0, y0, z0, and t0
-	if(dutils::is_valid(esort[0])) {
+	if((derived & dragon::derived::BGO_HIT) && dutils::is_valid(esort[0])) {
 		hit0 = isort[0];
 		sum = dutils::calculate_sum(ecal, ecal + MAX_CHANNELS);
 		x0 = variables.pos.x[ isort[0] ];
@@ -238,6 +385,8 @@ void dragon::Bgo::Variables::reset()
 		pos.y[i] = bgoCoords[i][1];
 		pos.z[i] = bgoCoords[i][2];
 	}
+
+	nsort = MAX_CHANNELS;
 }
 
 bool dragon::Bgo::Variables::set(const char* dbfile)
@@ -268,6 +417,12 @@ bool dragon::Bgo::Variables::set(const midas::Database* db)
 	if(success) success = db->ReadArray("/dragon/bgo/variables/position/y",  pos.y, MAX_CHANNELS);
 	if(success) success = db->ReadArray("/dragon/bgo/variables/position/z",  pos.z, MAX_CHANNELS);
 
+	if(success) { // optional, older ODBs always do the full sort
+		dragon::utils::ChangeErrorIgnore dummy(9001);
+		if(!db->ReadValue("/dragon/bgo/variables/nsort", nsort))
+			nsort = MAX_CHANNELS;
+	}
+
 	return success;
 }
 
@@ -299,10 +454,32 @@ void dragon::Dsssd::read_data(const vme::V785 adcs[], const vme::V1190& tdc)
 	 * \param [in] tdc vme::V1190 tdc module from which data can be read
 	 */
 	dutils::channel_map(ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	read_tdc(tdc);
+}
+
+void dragon::Dsssd::read_tdc(const vme::V1190& tdc)
+{
+	/*!
+	 * Copies tdc data into \c this->tfront and \c this->tback
+	 * \param [in] tdc vme::V1190 tdc module from which data can be read
+	 */
 	dutils::channel_map(tfront, variables.tdc_front.channel, tdc);
 	dutils::channel_map(tback,  variables.tdc_back.channel,  tdc);
 }
 
+void dragon::Dsssd::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+																const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->ecal[] (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, numAdc);
+}
+
 void dragon::Dsssd::calculate()
 {
 	/*!
@@ -415,9 +592,30 @@ void dragon::IonChamber::read_data(const vme::V785 adcs[], const vme::V1190& tdc
 	 * \param [in] v1190_trigger_ch Channel number of the v1190b trigger
 	 */
 	dutils::channel_map(anode, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	read_tdc(tdc);
+}
+
+void dragon::IonChamber::read_tdc(const vme::V1190& tdc)
+{
+	/*!
+	 * \param [in] tdc vme::V1190 tdc module from which data can be read
+	 */
 	dutils::channel_map(tcal, MAX_TDC, variables.tdc.channel, tdc);
 }
 
+void dragon::IonChamber::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+																		 const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->anode[] (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, anode, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, numAdc);
+}
+
 void dragon::IonChamber::calculate()
 {
 	/*!
@@ -511,15 +709,39 @@ void dragon::Mcp::read_data(const vme::V785 adcs[], const vme::V1190& tdc)
 	 * \param [in] tdc vme::V1190 tdc module from which data can be read
 	 */
 	dutils::channel_map(anode, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
-	dutils::channel_map(tcal, NUM_DETECTORS, variables.tdc.channel, tdc);
 	dutils::channel_map(tac, variables.tac_adc.channel, variables.tac_adc.module, adcs);
+	read_tdc(tdc);
 }
 
-void dragon::Mcp::calculate()
+void dragon::Mcp::read_tdc(const vme::V1190& tdc)
 {
 	/*!
+	 * \param [in] tdc vme::V1190 tdc module from which data can be read
+	 */
+	dutils::channel_map(tcal, NUM_DETECTORS, variables.tdc.channel, tdc);
+}
+
+void dragon::Mcp::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+															const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->anode[] and \c this->tac (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, anode, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, numAdc);
+	plan.add(base, tac, variables.tac_adc.channel, variables.tac_adc.module, adcs, numAdc);
+}
+
+void dragon::Mcp::calculate(uint32_t derived)
+{
+	/*!
+	 * \param derived Resolved mask of dragon::derived quantities to calculate
+	 *
 	 * Calibrates anode, tcal, and tac values; calculates x- and
-	 * y-positions.
+	 * y-positions (if dragon::derived::MCP_POS is set).
 	 *
 	 * \note Position calculation algorithm taken from the MSc thesis of
 	 * Michael Lamey, Simon Fraser University, 2001, p. 25; available online at
@@ -533,7 +755,7 @@ void dragon::Mcp::calculate()
 	dutils::calculate_sum(anode, anode + MAX_CHANNELS);
 
 	// Position calculation if we have all valid anode signals
-	if(dutils::is_valid_all(anode, MAX_CHANNELS)) {
+	if((derived & dragon::derived::MCP_POS) && dutils::is_valid_all(anode, MAX_CHANNELS)) {
 		const double Lhalf = 25.;  // half the length of a single side of the MCP (50/2 [mm])
 		double sum = 0;
 		for(int i=0; i< MAX_CHANNELS; ++i) sum += anode[i];
@@ -636,6 +858,19 @@ void dragon::SurfaceBarrier::read_data(const vme::V785 adcs[], const vme::V1190&
 	dutils::channel_map(ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
 }
 
+void dragon::SurfaceBarrier::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+																				 const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->ecal[] (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, numAdc);
+}
+
 void dragon::SurfaceBarrier::calculate()
 {
 	/*!
@@ -716,6 +951,19 @@ void dragon::NaI::read_data(const vme::V785 adcs[], const vme::V1190&)
 	dutils::channel_map(ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
 }
 
+void dragon::NaI::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+															const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->ecal[] (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, numAdc);
+}
+
 void dragon::NaI::calculate()
 {
 	/// Linear calibration of energies
@@ -791,6 +1039,19 @@ void dragon::Ge::read_data(const vme::V785 adcs[], const vme::V1190&)
 	dutils::channel_map(ecal, variables.adc.channel, variables.adc.module, adcs);
 }
 
+void dragon::Ge::add_to_plan(dutils::GatherPlan<vme::V785>& plan, const void* base,
+														 const vme::V785 adcs[], int numAdc)
+{
+	/*!
+	 * Adds the mapping of \c this->ecal (same as read_data()) to \e plan
+	 * \param plan Plan to add to
+	 * \param base Object containing \c this, as used with GatherPlan::gather()
+	 * \param [in] adcs Array of vme::V785 adc modules the plan will be used with
+	 * \param numAdc Length of \e adcs
+	 */
+	plan.add(base, ecal, variables.adc.channel, variables.adc.module, adcs, numAdc);
+}
+
 void dragon::Ge::calculate()
 {
 	/// Calibration of energies
@@ -880,7 +1141,8 @@ void dragon::HiTof::calculate(const dragon::Tail* tail)
 
 // ==================== Class dragon::Head ==================== //
 
-dragon::Head::Head()
+dragon::Head::Head():
+	fDerived(dragon::derived::ALL), fDirty(DIRTY_ALL)
 {
 	/*!
 	 * Set bank names, resets data to default values
@@ -888,19 +1150,58 @@ dragon::Head::Head()
 	reset();
 }
 
+namespace {
+
+/// Head::reset() for the components flagged in \e dirty
+void reset_head(dragon::Head& h, uint32_t dirty)
+{
+	if(dirty & dragon::Head::DIRTY_HEADER) {
+		const midas::Event::Header temp = { 0, 0, 0, 0, 0 };
+		h.header = temp;
+	}
+	if(dirty & dragon::Head::DIRTY_IO32) h.io32.reset();
+	if(dirty & dragon::Head::DIRTY_ADC)  h.v792.reset();
+	if(dirty & dragon::Head::DIRTY_TDC)  h.v1190.reset();
+	if(dirty & dragon::Head::DIRTY_BGO)  h.bgo.reset();
+	if(dirty & dragon::Head::DIRTY_TRF)  h.trf.reset();
+	if(dirty & dragon::Head::DIRTY_TCAL) dutils::reset_data(h.tcalx, h.tcal0, h.tcal_rf);
+}
+
+} // namespace
+
 void dragon::Head::reset()
 {
 	/*!
 	 * Call reset() for all members that are classes, reset raw data to defaults.
+	 *
+	 * Only components written since the last reset (by unpack(), calculate(), or
+	 * flagged with mark_dirty()) are reset, the others already have their default
+	 * values. Code writing data fields directly needs to call mark_dirty(). Compile
+	 * with \c -DDRAGON_DEBUG_RESET to check the result against a full reset.
 	 */
-	const midas::Event::Header temp = { 0, 0, 0, 0, 0 };
-	header = temp;
-	io32.reset();
-	v792.reset();
-	v1190.reset();
-	bgo.reset();
-	trf.reset();
-	dutils::reset_data(tcalx, tcal0, tcal_rf);
+	reset_head(*this, fDirty);
+	fDirty = 0;
+
+#ifdef DRAGON_DEBUG_RESET
+	const char* const where = "dragon::Head::reset";
+	if(header.fEventId || header.fTriggerMask || header.fSerialNumber || header.fTimeStamp || header.fDataSize)
+		report_reset(where, "header");
+	check_reset(where, "v792", v792);
+	check_reset(where, "bgo", bgo, data_size(bgo));
+	check_reset(where, "trf", trf, data_size(trf));
+	check_reset(where, "tcalx", tcalx);
+	check_reset(where, "tcal0", tcal0);
+	check_reset(where, "tcal_rf", tcal_rf);
+#endif
+}
+
+void dragon::Head::set_derived(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of dragon::derived::Quantity_t values; quantities
+	 *  these depend on are added automatically.
+	 */
+	fDerived = dragon::derived::resolve(mask);
 }
 
 bool dragon::Head::set_variables(const char* dbfile)
@@ -930,6 +1231,7 @@ bool dragon::Head::set_variables(const midas::Database* db)
 			v1190.fMessagePeriod = period;
 		else
 			v1190.fMessagePeriod = 0;
+		v1190.fErrorCounts.ResetTotals();
 	}
 
 	return success;
@@ -955,6 +1257,7 @@ void dragon::Head::unpack(const midas::Event& event)
 	v792.unpack (event, variables.bk_adc , report);
 	v1190.unpack(event, variables.bk_tdc,  report);
 	event.CopyHeader(header);
+	mark_dirty(DIRTY_HEADER | DIRTY_IO32 | DIRTY_ADC | DIRTY_TDC);
 }
 
 void dragon::Head::calculate()
@@ -970,7 +1273,7 @@ void dragon::Head::calculate()
 	 */
 	/// - Read BGO data and calculate (see dragon::Head::Bgo).
 	bgo.read_data(v792, v1190);
-	bgo.calculate();
+	bgo.calculate(fDerived);
 
 	trf.read_data(v1190);
 	trf.calculate();
@@ -986,6 +1289,8 @@ void dragon::Head::calculate()
 	/// - Read and calibrate t0 (trigger) channel
 	dutils::channel_map(tcal0, variables.tdc0.channel, v1190);
 	dutils::linear_calibrate(tcal0, variables.tdc0);
+
+	mark_dirty(DIRTY_BGO | DIRTY_TRF | DIRTY_TCAL);
 }
 
 
@@ -1056,37 +1361,169 @@ bool dragon::Head::Variables::set(const midas::Database* db)
 
 // ================ Class dragon::Tail ================ //
 
-dragon::Tail::Tail()
+namespace {
+
+/// Tail::reset() for the detectors enabled in \c MASK and the components flagged in \e dirty
+template <uint32_t MASK>
+void reset_tail(dragon::Tail& t, uint32_t dirty)
+{
+	if(dirty & dragon::Tail::DIRTY_IO32) t.io32.reset();
+	if(dirty & dragon::Tail::DIRTY_TDC)  t.v1190.reset();
+	if(dirty & dragon::Tail::DIRTY_ADC) {
+		for (int i=0; i< dragon::Tail::NUM_ADC; ++i) {
+			t.v785[i].reset();
+		}
+	}
+	if(dirty & dragon::Tail::DIRTY_TRF) t.trf.reset();
+#ifndef DRAGON_OMIT_DSSSD
+	if((MASK & dragon::Tail::ENABLE_DSSSD) && (dirty & dragon::Tail::DIRTY_DSSSD)) t.dsssd.reset();
+#endif
+#ifndef DRAGON_OMIT_IC
+	if((MASK & dragon::Tail::ENABLE_IC) && (dirty & dragon::Tail::DIRTY_IC)) t.ic.reset();
+#endif
+#ifndef DRAGON_OMIT_NAI
+	if((MASK & dragon::Tail::ENABLE_NAI) && (dirty & dragon::Tail::DIRTY_NAI)) t.nai.reset();
+#endif
+#ifndef DRAGON_OMIT_GE
+	if((MASK & dragon::Tail::ENABLE_GE) && (dirty & dragon::Tail::DIRTY_GE)) t.ge.reset();
+#endif
+	if(dirty & dragon::Tail::DIRTY_MCP) t.mcp.reset();
+	if(dirty & dragon::Tail::DIRTY_SB)  t.sb.reset();
+	if(dirty & dragon::Tail::DIRTY_TOF) t.tof.reset();
+	if(dirty & dragon::Tail::DIRTY_TCAL) dutils::reset_data(t.tcalx, t.tcal0, t.tcal_rf);
+}
+
+/// Components written by calculate_tail<MASK>(), other than the optional TOFs
+template <uint32_t MASK>
+struct TailDirty {
+	static const uint32_t value =
+		dragon::Tail::DIRTY_MCP | dragon::Tail::DIRTY_SB | dragon::Tail::DIRTY_TRF | dragon::Tail::DIRTY_TCAL |
+		((MASK & dragon::Tail::ENABLE_DSSSD) ? dragon::Tail::DIRTY_DSSSD : 0) |
+		((MASK & dragon::Tail::ENABLE_IC)    ? dragon::Tail::DIRTY_IC    : 0) |
+		((MASK & dragon::Tail::ENABLE_NAI)   ? dragon::Tail::DIRTY_NAI   : 0) |
+		((MASK & dragon::Tail::ENABLE_GE)    ? dragon::Tail::DIRTY_GE    : 0);
+};
+
+/// Tail::calculate() for the detectors enabled in \c MASK
+template <uint32_t MASK>
+void calculate_tail(dragon::Tail& t)
+{
+	/// - Read data from VME modules into data structures: all ADC
+	///   channels in one pass through the gather plan (rebuilt first if the
+	///   channel mapping was changed by hand), then the TDCs
+	if(!t.fAdcPlan.is_current(&t)) t.build_plan();
+	t.fAdcPlan.gather(t.v785, &t);
+#ifndef DRAGON_OMIT_DSSSD
+	if(MASK & dragon::Tail::ENABLE_DSSSD) t.dsssd.read_tdc(t.v1190);
+#endif
+#ifndef DRAGON_OMIT_IC
+	if(MASK & dragon::Tail::ENABLE_IC) t.ic.read_tdc(t.v1190);
+#endif
+	t.mcp.read_tdc(t.v1190);
+	t.trf.read_data(t.v1190);
+
+	/// - Perform calibrations, higher-order calculations, etc, detector-by-detector
+#ifndef DRAGON_OMIT_DSSSD
+	if(MASK & dragon::Tail::ENABLE_DSSSD) t.dsssd.calculate();
+#endif
+#ifndef DRAGON_OMIT_IC
+	if(MASK & dragon::Tail::ENABLE_IC) t.ic.calculate();
+#endif
+	t.mcp.calculate(t.get_derived());
+	t.sb.calculate();
+#ifndef DRAGON_OMIT_NAI
+	if(MASK & dragon::Tail::ENABLE_NAI) t.nai.calculate();
+#endif
+#ifndef DRAGON_OMIT_GE
+	if(MASK & dragon::Tail::ENABLE_GE) t.ge.calculate();
+#endif
+	t.trf.calculate();
+
+	/// - Calculate TOF between HI detectors
+	t.mark_dirty(TailDirty<MASK>::value);
+	if(t.get_derived() & dragon::derived::HI_TOF) {
+		t.tof.calculate(&t);
+		t.mark_dirty(dragon::Tail::DIRTY_TOF);
+	}
+
+	/// - Map and calibrate "crossover" TDC
+	dutils::channel_map(t.tcalx, t.variables.xtdc.channel, t.v1190);
+	dutils::linear_calibrate(t.tcalx, t.variables.xtdc);
+
+	/// - Map and calibrate RF TDC
+	dutils::channel_map(t.tcal_rf, t.variables.rf_tdc.channel, t.v1190);
+	dutils::linear_calibrate(t.tcal_rf, t.variables.rf_tdc);
+
+	/// - Map and calibrate "trigger" TDC
+	dutils::channel_map(t.tcal0, t.variables.tdc0.channel, t.v1190);
+	dutils::linear_calibrate(t.tcal0, t.variables.tdc0);
+}
+
+/// Specialized reset and calculate functions, one per enable mask
+struct TailDispatch {
+	void (*fReset)(dragon::Tail&, uint32_t);
+	void (*fCalculate)(dragon::Tail&);
+};
+
+#define TAIL_DISPATCH(mask) { &reset_tail<mask>, &calculate_tail<mask> }
+const TailDispatch gTailDispatch[dragon::Tail::ENABLE_ALL + 1] = {
+	TAIL_DISPATCH(0x0), TAIL_DISPATCH(0x1), TAIL_DISPATCH(0x2), TAIL_DISPATCH(0x3),
+	TAIL_DISPATCH(0x4), TAIL_DISPATCH(0x5), TAIL_DISPATCH(0x6), TAIL_DISPATCH(0x7),
+	TAIL_DISPATCH(0x8), TAIL_DISPATCH(0x9), TAIL_DISPATCH(0xa), TAIL_DISPATCH(0xb),
+	TAIL_DISPATCH(0xc), TAIL_DISPATCH(0xd), TAIL_DISPATCH(0xe), TAIL_DISPATCH(0xf)
+};
+#undef TAIL_DISPATCH
+
+} // namespace
+
+dragon::Tail::Tail():
+	fEnabled(ENABLE_ALL), fDisabled(0), fDerived(dragon::derived::ALL), fDirty(DIRTY_ALL)
 {
 	/// ::
 	reset();
+	build_plan();
 }
 
 void dragon::Tail::reset()
 {
-	/// ::
-	io32.reset();
-	v1190.reset();
+	/*!
+	 * Only detectors enabled in the mask set by set_enabled() are reset;
+	 * disabled ones keep the default values set when they were disabled.
+	 *
+	 * Of those, only components written since the last reset (by unpack(),
+	 * calculate(), or flagged with mark_dirty()) are reset, the others already
+	 * have their default values. Code writing data fields directly needs to call
+	 * mark_dirty(). Compile with \c -DDRAGON_DEBUG_RESET to check the result
+	 * against a full reset.
+	 */
+	gTailDispatch[fEnabled].fReset(*this, fDirty);
+	fDirty = 0;
+
+#ifdef DRAGON_DEBUG_RESET
+	const char* const where = "dragon::Tail::reset";
 	for (int i=0; i< NUM_ADC; ++i) {
-		v785[i].reset();
+		check_reset(where, "v785", v785[i]);
 	}
-	trf.reset();
 #ifndef DRAGON_OMIT_DSSSD
-	dsssd.reset();
+	check_reset(where, "dsssd", dsssd, data_size(dsssd));
 #endif
 #ifndef DRAGON_OMIT_IC
-	ic.reset();
+	check_reset(where, "ic", ic, data_size(ic));
 #endif
 #ifndef DRAGON_OMIT_NAI
-	nai.reset();
+	check_reset(where, "nai", nai, data_size(nai));
 #endif
 #ifndef DRAGON_OMIT_GE
-	ge.reset();
+	check_reset(where, "ge", ge, data_size(ge));
+#endif
+	check_reset(where, "mcp", mcp, data_size(mcp));
+	check_reset(where, "sb", sb, data_size(sb));
+	check_reset(where, "tof", tof);
+	check_reset(where, "trf", trf, data_size(trf));
+	check_reset(where, "tcalx", tcalx);
+	check_reset(where, "tcal0", tcal0);
+	check_reset(where, "tcal_rf", tcal_rf);
 #endif
-	mcp.reset();
-	sb.reset();
-	tof.reset();
-	dutils::reset_data(tcalx, tcal0, tcal_rf);
 }
 
 void dragon::Tail::unpack(const midas::Event& event)
@@ -1112,58 +1549,82 @@ void dragon::Tail::unpack(const midas::Event& event)
 	v1190.unpack(event, variables.bk_tdc, report);
 
 	event.CopyHeader(header);
+	mark_dirty(DIRTY_IO32 | DIRTY_ADC | DIRTY_TDC);
 }
 
 void dragon::Tail::calculate()
 {
-	/// - Read data from VME modules into data structures
-#ifndef DRAGON_OMIT_DSSSD
-	dsssd.read_data(v785, v1190);
-#endif
-#ifndef DRAGON_OMIT_IC
-	ic.read_data(v785, v1190);
-#endif
-	mcp.read_data(v785, v1190);
-	sb.read_data(v785, v1190);
-#ifndef DRAGON_OMIT_NAI
-	nai.read_data(v785, v1190);
-#endif
-#ifndef DRAGON_OMIT_GE
-	ge.read_data(v785, v1190);
-#endif
-	trf.read_data(v1190);
+	/*!
+	 * Reads data from the VME modules into the detector structures, then
+	 * performs calibrations and higher-level calculations detector-by-detector,
+	 * HI time-of-flights, and the crossover, RF and trigger TDCs.
+	 *
+	 * Detectors not enabled in the mask set by set_enabled() are skipped. The
+	 * work is done by a version of the calculation specialized at compile time
+	 * for the current mask, so there is no per-detector branching.
+	 */
+	gTailDispatch[fEnabled].fCalculate(*this);
+}
 
-	/// - Perform calibrations, higher-order calculations, etc, detector-by-detector
+void dragon::Tail::set_enabled(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of EnableBits_t values, detectors whose bit is
+	 *  not set are skipped by reset() and calculate() and always contain
+	 *  default (invalid) values. Detectors disabled through set_disabled()
+	 *  stay disabled.
+	 *
+	 * Called by set_variables() with the value of variables.enable.
+	 */
+	fEnabled = mask & ~fDisabled & ENABLE_ALL;
+	gTailDispatch[ENABLE_ALL].fReset(*this, DIRTY_ALL);
+	fDirty = 0;
+	build_plan();
+}
+
+void dragon::Tail::set_derived(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of dragon::derived::Quantity_t values; quantities
+	 *  these depend on are added automatically.
+	 */
+	fDerived = dragon::derived::resolve(mask);
+}
+
+void dragon::Tail::set_disabled(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of EnableBits_t values to disable, regardless of
+	 *  the ODB setting in later calls to set_variables(). Intended for command
+	 *  line overrides.
+	 */
+	fDisabled = mask & ENABLE_ALL;
+	set_enabled(variables.enable);
+}
+
+void dragon::Tail::build_plan()
+{
+	/*!
+	 * Collects the ADC channel mappings of all detectors into \c fAdcPlan,
+	 * used by calculate() in place of the individual read_data() calls.
+	 * Disabled detectors are left out. Called by set_variables() and set_enabled(),
+	 * and by calculate() when a channel mapping was changed by hand.
+	 */
+	fAdcPlan.clear();
 #ifndef DRAGON_OMIT_DSSSD
-	dsssd.calculate();
+	if(fEnabled & ENABLE_DSSSD) dsssd.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
 #endif
 #ifndef DRAGON_OMIT_IC
-	ic.calculate();
+	if(fEnabled & ENABLE_IC) ic.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
 #endif
-	mcp.calculate();
-	sb.calculate();
+	mcp.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
+	sb.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
 #ifndef DRAGON_OMIT_NAI
-	nai.calculate();
+	if(fEnabled & ENABLE_NAI) nai.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
 #endif
 #ifndef DRAGON_OMIT_GE
-	ge.calculate();
+	if(fEnabled & ENABLE_GE) ge.add_to_plan(fAdcPlan, this, v785, NUM_ADC);
 #endif
-	trf.calculate();
-
-	/// - Calculate TOF between HI detectors
-	tof.calculate(this);
-
-	/// - Map and calibrate "crossover" TDC
-	dutils::channel_map(tcalx, variables.xtdc.channel, v1190);
-	dutils::linear_calibrate(tcalx, variables.xtdc);
-
-	/// - Map and calibrate RF TDC
-	dutils::channel_map(tcal_rf, variables.rf_tdc.channel, v1190);
-	dutils::linear_calibrate(tcal_rf, variables.rf_tdc);
-
-	/// - Map and calibrate "trigger" TDC
-	dutils::channel_map(tcal0, variables.tdc0.channel, v1190);
-	dutils::linear_calibrate(tcal0, variables.tdc0);
 }
 
 bool dragon::Tail::set_variables(const char* dbfile)
@@ -1211,8 +1672,11 @@ bool dragon::Tail::set_variables(const midas::Database* db)
 			v1190.fMessagePeriod = period;
 		else
 			v1190.fMessagePeriod = 0;
+		v1190.fErrorCounts.ResetTotals();
 	}
 
+	if(success) set_enabled(variables.enable);
+
 	return success;
 }
 
@@ -1244,6 +1708,8 @@ void dragon::Tail::Variables::reset()
 	tdc0.channel = TAIL_RF_TDC + 1;
 	tdc0.slope  = 1.;
 	tdc0.offset = 0.;
+
+	enable = dragon::Tail::ENABLE_ALL;
 }
 
 bool dragon::Tail::Variables::set(const char* dbfile)
@@ -1278,6 +1744,12 @@ bool dragon::Tail::Variables::set(const midas::Database* db)
 	if(success) success = db->ReadValue("/dragon/tail/variables/tdc0/slope",   tdc0.slope);
 	if(success) success = db->ReadValue("/dragon/tail/variables/tdc0/offset",  tdc0.offset);
 
+	if(success) { // optional, older ODBs process all detectors
+		dragon::utils::ChangeErrorIgnore dummy(9001);
+		if(!db->ReadValue("/dragon/tail/variables/enable", enable))
+			enable = dragon::Tail::ENABLE_ALL;
+	}
+
 	return success;
 }
 
@@ -1435,13 +1907,15 @@ bool dragon::Scaler::Variables::set(const midas::Database* db, const char* dir)
 
 // ==================== Class dragon::Coinc ==================== //
 
-dragon::Coinc::Coinc()
+dragon::Coinc::Coinc():
+	fDerived(dragon::derived::ALL), fDirty(true)
 {
 	/// ::
 	reset();
 }
 
-dragon::Coinc::Coinc(const dragon::Head& head_, const dragon::Tail& tail_)
+dragon::Coinc::Coinc(const dragon::Head& head_, const dragon::Tail& tail_):
+	fDerived(dragon::derived::ALL), fDirty(true)
 {
 	/// ::
 	compose_event(head_, tail_);
@@ -1449,10 +1923,14 @@ dragon::Coinc::Coinc(const dragon::Head& head_, const dragon::Tail& tail_)
 
 void dragon::Coinc::reset()
 {
-	/// ::
+	/*!
+	 * Head and tail parts are reset as in Head::reset() and Tail::reset(), the
+	 * coincidence parameters only if they were written since the last reset.
+	 */
 	head.reset();
 	tail.reset();
-	dutils::reset_data(xtrig, xtofh, xtoft);
+	if(fDirty) dutils::reset_data(xtrig, xtofh, xtoft);
+	fDirty = false;
 }
 
 bool dragon::Coinc::set_variables(const char* dbfile)
@@ -1485,6 +1963,20 @@ void dragon::Coinc::compose_event(const dragon::Head& head_, const dragon::Tail&
 	 */
 	head = head_;
 	tail = tail_;
+	head.set_derived(fDerived);
+	tail.set_derived(fDerived);
+}
+
+void dragon::Coinc::set_derived(uint32_t mask)
+{
+	/*!
+	 * \param mask Bitwise OR of dragon::derived::Quantity_t values; quantities
+	 *  these depend on are added automatically. Also applies to the head and
+	 *  tail parts of the event.
+	 */
+	fDerived = dragon::derived::resolve(mask);
+	head.set_derived(fDerived);
+	tail.set_derived(fDerived);
 }
 
 void dragon::Coinc::unpack(const midas::CoincEvent& coincEvent)
@@ -1504,9 +1996,12 @@ void dragon::Coinc::calculate()
 	 */
 	head.calculate();
 	tail.calculate();
-	xtrig = dutils::calculate_tof(tail.io32.tsc4.trig_time, head.io32.tsc4.trig_time);
-	xtoft = dutils::calculate_tof(tail.tcal0, tail.tcalx);
-	xtofh = dutils::calculate_tof(head.tcalx, head.tcal0);
+	if(fDerived & dragon::derived::COINC_TOF) {
+		xtrig = dutils::calculate_tof(tail.io32.tsc4.trig_time, head.io32.tsc4.trig_time);
+		xtoft = dutils::calculate_tof(tail.tcal0, tail.tcalx);
+		xtofh = dutils::calculate_tof(head.tcalx, head.tcal0);
+		mark_dirty();
+	}
 }
 
 
@@ -1545,6 +2040,37 @@ bool dragon::Coinc::Variables::set(const midas::Database* db)
 }
 
 
+// ==================== Class dragon::CoincLink ==================== //
+
+dragon::CoincLink::CoincLink()
+{
+	/// ::
+	reset();
+}
+
+dragon::CoincLink::CoincLink(const dragon::Coinc& coinc)
+{
+	/// ::
+	set(coinc);
+}
+
+void dragon::CoincLink::reset()
+{
+	/// ::
+	dutils::reset_data(head_serial, tail_serial, xtrig, xtofh, xtoft);
+}
+
+void dragon::CoincLink::set(const dragon::Coinc& coinc)
+{
+	/*!
+	 * \param [in] coinc Coincidence event, unpacked and calculated
+	 */
+	head_serial = coinc.head.header.fSerialNumber;
+	tail_serial = coinc.tail.header.fSerialNumber;
+	xtrig = coinc.xtrig;
+	xtofh = coinc.xtofh;
+	xtoft = coinc.xtoft;
+}
 // ====================== Class dragon::Epics ====================== //
 
 dragon::Epics::Epics()
@@ -11,6 +11,7 @@
 #include <string>
 #include <sstream>
 #include "utils/VariableStructs.hxx"
+#include "utils/GatherPlan.hxx"
 #include "midas/Event.hxx"
 #include "Vme.hxx"
 
@@ -35,6 +36,34 @@ namespace vme {
 namespace dragon {
 
 	class Tail; // forward declaration
+	class ScalerIndex; // forward declaration
+
+	///
+	/// Derived quantities which are only calculated on demand
+	///
+	/*!
+	 * Each quantity declares the others it is computed from (see resolve()).
+	 * Front ends declare what they need, e.g. from the parameter expressions of
+	 * their histograms (see from_expression()), and pass the result to the
+	 * event classes' set_derived(). Quantities that are not needed are skipped
+	 * in calculate() and keep their default (invalid) values. Everything is
+	 * calculated by default.
+	 */
+	namespace derived {
+		/// Derived quantity bits
+		enum Quantity_t {
+			BGO_SORT  = 0x01, ///< bgo.esort[]
+			BGO_HIT   = 0x02, ///< bgo.sum, hit0, x0, y0, z0, t0 (needs BGO_SORT)
+			MCP_POS   = 0x04, ///< mcp.x, mcp.y
+			HI_TOF    = 0x08, ///< tof.* (tail heavy-ion time-of-flights)
+			COINC_TOF = 0x10, ///< xtrig, xtofh, xtoft (coincidence time-of-flights)
+			ALL       = 0x1f  ///< Everything
+		};
+		/// Add all quantities needed to calculate the ones in a mask
+		uint32_t resolve(uint32_t mask);
+		/// Find the derived quantities referenced in a parameter expression
+		uint32_t from_expression(const std::string& expression);
+	}
 
 	// ======= Class definitions ======== //
 	///
@@ -82,7 +111,7 @@ namespace dragon {
 		/// Read adc & tdc data
 		void read_data(const vme::V792& adc, const vme::V1190& tdc);
 		/// Do higher-level parameter calculations
-		void calculate();
+		void calculate(uint32_t derived = dragon::derived::ALL);
 
 	public: // Data
 		/// Calibrated energies
@@ -126,6 +155,11 @@ namespace dragon {
 			dragon::utils::TdcVariables<MAX_CHANNELS> tdc;
 			/// Detector positions in space
 			dragon::utils::PositionVariables<MAX_CHANNELS> pos;
+			/// \brief Number of entries of esort[] to calculate
+			/// \details Values below MAX_CHANNELS only select the highest `nsort`
+			///  energies (the rest of esort[] stays invalid); `hit0`, `sum` and the
+			///  position/time of the highest hit are still calculated.
+			int nsort;
 		};
 
 	public: // Subclass instances
@@ -148,6 +182,11 @@ namespace dragon {
 		void reset();
 		/// Read data from vme modules
 		void read_data(const vme::V785 adcs[], const vme::V1190& tdc);
+		/// Read tdc data only (adc data read through a GatherPlan)
+		void read_tdc(const vme::V1190& tdc);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Performs energy and time calibrations
 		void calculate();
 
@@ -213,6 +252,11 @@ namespace dragon {
 		void reset();
 		/// Read midas event data
 		void read_data(const vme::V785 adcs[], const vme::V1190& tdc);
+		/// Read tdc data only (adc data read through a GatherPlan)
+		void read_tdc(const vme::V1190& tdc);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Calculate higher-level parameters
 		void calculate();
 
@@ -268,8 +312,13 @@ namespace dragon {
 		void reset();
 		/// Read midas event data
 		void read_data(const vme::V785 adcs[], const vme::V1190& tdc);
+		/// Read tdc data only (adc data read through a GatherPlan)
+		void read_tdc(const vme::V1190& tdc);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Calibrate ADC/TDC signals, calculate x and y positions
-		void calculate();
+		void calculate(uint32_t derived = dragon::derived::ALL);
 
 	public: // Data
 		/// Anode signals
@@ -349,6 +398,9 @@ namespace dragon {
 		void reset();
 		/// Read midas event data
 		void read_data(const vme::V785 adcs[], const vme::V1190&);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Final energy calculation
 		void calculate();
 
@@ -374,6 +426,9 @@ namespace dragon {
 		void reset();
 		/// Read event data from vme modules
 		void read_data(const vme::V785 adcs[], const vme::V1190&);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Do energy calibrations
 		void calculate();
 
@@ -417,6 +472,9 @@ namespace dragon {
 		void reset();
 		/// Read event data from the ADC
 		void read_data(const vme::V785 adcs[], const vme::V1190&);
+		/// Add the ADC channel mapping to a flattened gather plan
+		void add_to_plan(dragon::utils::GatherPlan<vme::V785>& plan, const void* base,
+										 const vme::V785 adcs[], int numAdc);
 		/// Do energy calibrations, pedestal subtractions
 		void calculate();
 
@@ -528,6 +586,17 @@ namespace dragon {
 	public: // Constants
 		/// Max number of RF hits to store
 		static const int MAX_RF_HITS = 5;
+		/// Components tracked for reset(), see mark_dirty()
+		enum DirtyBits_t {
+			DIRTY_HEADER = 0x01, ///< header
+			DIRTY_IO32   = 0x02, ///< io32
+			DIRTY_ADC    = 0x04, ///< v792
+			DIRTY_TDC    = 0x08, ///< v1190
+			DIRTY_BGO    = 0x10, ///< bgo
+			DIRTY_TRF    = 0x20, ///< trf
+			DIRTY_TCAL   = 0x40, ///< tcalx, tcal0, tcal_rf
+			DIRTY_ALL    = 0x7f  ///< Everything
+		};
 
 	public: // Methods
 		/// Initializes data values
@@ -542,6 +611,12 @@ namespace dragon {
 		void unpack(const midas::Event& event);
 		/// Calculate higher-level data for each detector, or across detectors
 		void calculate();
+		/// Set which derived quantities are calculated (dragon::derived::Quantity_t)
+		void set_derived(uint32_t mask);
+		/// Get the (resolved) mask of derived quantities calculated
+		uint32_t get_derived() const { return fDerived; }
+		/// Flag components as written since the last reset()
+		void mark_dirty(uint32_t components = DIRTY_ALL) { fDirty |= components; }
 
 	public: // Data
 		/// Midas event header
@@ -606,6 +681,12 @@ namespace dragon {
 	public: // Subclass instances
 		/// Variables instance
 		Head::Variables variables; //!
+
+	private:
+		/// Derived quantities to calculate
+		uint32_t fDerived; //!
+		/// Components written since the last reset() (DirtyBits_t)
+		uint32_t fDirty; //!
 	};
 
 	///
@@ -617,6 +698,30 @@ namespace dragon {
 		static const int NUM_ADC = 2;
 		/// Max number of RF hits to store
 		static const int MAX_RF_HITS = 5;
+		/// Bits of the detector enable mask, see set_enabled()
+		enum EnableBits_t {
+			ENABLE_DSSSD = 0x1, ///< DSSSD
+			ENABLE_IC    = 0x2, ///< Ionization chamber
+			ENABLE_NAI   = 0x4, ///< NaI detectors
+			ENABLE_GE    = 0x8, ///< Germanium detector
+			ENABLE_ALL   = 0xf  ///< All detectors
+		};
+		/// Components tracked for reset(), see mark_dirty()
+		enum DirtyBits_t {
+			DIRTY_IO32   = 0x0001, ///< io32
+			DIRTY_ADC    = 0x0002, ///< v785[]
+			DIRTY_TDC    = 0x0004, ///< v1190
+			DIRTY_DSSSD  = 0x0008, ///< dsssd
+			DIRTY_IC     = 0x0010, ///< ic
+			DIRTY_NAI    = 0x0020, ///< nai
+			DIRTY_GE     = 0x0040, ///< ge
+			DIRTY_MCP    = 0x0080, ///< mcp
+			DIRTY_SB     = 0x0100, ///< sb
+			DIRTY_TOF    = 0x0200, ///< tof
+			DIRTY_TRF    = 0x0400, ///< trf
+			DIRTY_TCAL   = 0x0800, ///< tcalx, tcal0, tcal_rf
+			DIRTY_ALL    = 0x0fff  ///< Everything
+		};
 
 	public: // Methods
 		/// Initializes data values
@@ -631,6 +736,20 @@ namespace dragon {
 		void unpack(const midas::Event& event);
 		/// Calculate higher-level data for each detector, or across detectors
 		void calculate();
+		/// Rebuild the ADC gather plan from the detector variables
+		void build_plan();
+		/// Set which detectors are processed
+		void set_enabled(uint32_t mask);
+		/// Permanently disable detectors, overriding the ODB enable mask
+		void set_disabled(uint32_t mask);
+		/// Get the mask of detectors currently processed
+		uint32_t get_enabled() const { return fEnabled; }
+		/// Set which derived quantities are calculated (dragon::derived::Quantity_t)
+		void set_derived(uint32_t mask);
+		/// Get the (resolved) mask of derived quantities calculated
+		uint32_t get_derived() const { return fDerived; }
+		/// Flag components as written since the last reset()
+		void mark_dirty(uint32_t components = DIRTY_ALL) { fDirty |= components; }
 
 	public: // Class data
 		/// Midas event header
@@ -699,6 +818,8 @@ namespace dragon {
 			dragon::utils::TdcVariables<1> rf_tdc;
 			/// Trigger TDC channel variables
 			dragon::utils::TdcVariables<1> tdc0;
+			/// Mask of detectors to process (EnableBits_t)
+			int enable;
 
 		public: // Methods
 			/// Sets data to defaults
@@ -714,6 +835,18 @@ namespace dragon {
 	public: // Subclass instances
 		/// Variables instance
 		Variables variables; //!
+		/// ADC channel mapping of all detectors, see build_plan()
+		dragon::utils::GatherPlan<vme::V785> fAdcPlan; //!
+
+	private:
+		/// Detectors processed by reset() and calculate()
+		uint32_t fEnabled; //!
+		/// Detectors disabled by set_disabled()
+		uint32_t fDisabled; //!
+		/// Derived quantities to calculate
+		uint32_t fDerived; //!
+		/// Components written since the last reset() (DirtyBits_t)
+		uint32_t fDirty; //!
 	};
 
 	///
@@ -759,6 +892,12 @@ namespace dragon {
 		void unpack(const midas::CoincEvent& coincEvent);
 		/// Calculates both singles and coincidence parameters
 		void calculate();
+		/// Set which derived quantities are calculated, for this and the head and tail parts
+		void set_derived(uint32_t mask);
+		/// Get the (resolved) mask of derived quantities calculated
+		uint32_t get_derived() const { return fDerived; }
+		/// Flag the coincidence parameters (xtrig, xtofh, xtoft) as written since the last reset()
+		void mark_dirty() { fDirty = true; }
 
 	public: // Data
 		/// Head (gamma-ray) part of the event
@@ -775,16 +914,68 @@ namespace dragon {
 	public: // Subclass instances
 		/// Variables instance
 		Variables variables; //!
+
+	private:
+		/// Derived quantities to calculate
+		uint32_t fDerived; //!
+		/// Coincidence parameters written since the last reset()
+		bool fDirty; //!
+	};
+
+	///
+	/// Compact coincidence event, linked to the head and tail singles events
+	///
+	/*!
+	 * Holds only the coincidence parameters of a dragon::Coinc and the serial
+	 * numbers of its head and tail parts. Every part of a coincidence is also
+	 * written as a singles event, so the remaining data are found in the head
+	 * and tail trees by serial number; see dragon::FriendCoinc().
+	 */
+	class CoincLink {
+	public: // Methods
+		/// Empty
+		CoincLink();
+		/// Construct from a coincidence event
+		CoincLink(const Coinc& coinc);
+		/// Reset data to defaults
+		void reset();
+		/// Copy data from a coincidence event
+		void set(const Coinc& coinc);
+
+	public: // Data
+		/// Serial number of the head event (`header.fSerialNumber` in the head tree)
+		uint32_t head_serial;
+		/// Serial number of the tail event (`header.fSerialNumber` in the tail tree)
+		uint32_t tail_serial;
+		/// (tail - head) io32 trigger times (usec)
+		double xtrig;
+		/// Crossover time-of-flight from the head TDC
+		double xtofh;
+		/// Crossover time-of-flight from the tail TDC
+		double xtoft;
 	};
 
 	///
 	/// Generic dragon scaler class
 	///
+	/*!
+	 * Counts over any time window are found from the scaler's running totals
+	 * (Scaler::Index), which mid2root writes to each file under the name given
+	 * by index_name():
+	 * \code
+	 * dragon::Scaler::Index* index =
+	 *   (dragon::Scaler::Index*)file->Get(dragon::Scaler::index_name("tail"));
+	 * \endcode
+	 */
 	class Scaler {
 	public: // Constants
 		/// Number of scaler channels
 		static const int MAX_CHANNELS = 17; //!
 
+	public: // Types
+		/// Running totals of the counts, for time-window integrals
+		typedef dragon::ScalerIndex Index;
+
 	public: // Methods
 		/// Initialize data
 		Scaler();
@@ -794,6 +985,8 @@ namespace dragon {
 		void unpack(const midas::Event& event);
 		/// Returns the name of a given scaler channel
 		const std::string& channel_name(int ch) const;
+		/// Name of the running-total index written for a scaler ("head", "tail" or "aux")
+		static const char* index_name(const char* which);
 		///  Reads all variable values from an database (file or online)
 		bool set_variables(const char* dbfile, const char* dir);
 		///  Reads all variable values from a constructed database
@@ -0,0 +1,268 @@
+///
+/// \file EpicsSeries.cxx
+/// \author G. Christian
+/// \brief Implements EpicsSeries.hxx
+///
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include "utils/Valid.hxx"
+#include "utils/ErrorDragon.hxx"
+#include "utils/VarInt.hxx"
+#include "Dragon.hxx"
+#include "EpicsSeries.hxx"
+
+namespace dutils = dragon::utils;
+
+
+namespace {
+
+/// Orders readings by time only, for stable sorting
+inline bool time_less(const std::pair<uint32_t, float>& lhs, const std::pair<uint32_t, float>& rhs)
+{ return lhs.first < rhs.first; }
+
+/// Compares a timestamp to a (fractional) time, for lower_bound()
+inline bool time_before(uint32_t time, double t)
+{ return time < t; }
+
+/// Compares a (fractional) time to a timestamp, for upper_bound()
+inline bool time_after(double t, uint32_t time)
+{ return t < time; }
+
+} // namespace
+
+
+// ====================== Class dragon::EpicsSeries ====================== //
+
+dragon::EpicsSeries::EpicsSeries():
+	fDecoded(false), fSorted(true)
+{
+	/*!
+	 * \note Objects read from file are default constructed too, then ROOT fills
+	 *  in the encoded data; leaving fDecoded false makes the first query decode it.
+	 */
+}
+
+void dragon::EpicsSeries::clear()
+{
+	/*! Removes both the time series and their encoded form. */
+	fChannels.clear();
+	fCounts.clear();
+	fTimeCodes.clear();
+	fValues.clear();
+	fSeries.clear();
+	fDecoded = true;
+	fSorted = true;
+}
+
+void dragon::EpicsSeries::add(const dragon::Epics& epics)
+{
+	/*!
+	 * \param epics Unpacked EPICS event; events without a valid channel
+	 *  number (failed unpacking) are ignored.
+	 */
+	if(!dutils::is_valid(epics.ch)) return;
+	add(epics.ch, epics.header.fTimeStamp, epics.val);
+}
+
+void dragon::EpicsSeries::add(int32_t ch, uint32_t time, float value)
+{
+	/*!
+	 * \param ch Channel number
+	 * \param time Timestamp of the reading
+	 * \param value Value of the reading
+	 *
+	 * Readings are normally added in time order; out of order readings are
+	 * accepted, and put in place at the next query or at encode().
+	 */
+	decode();
+	Series& series = fSeries[ch];
+	if(!series.time.empty() && time < series.time.back())
+		fSorted = false;
+	series.time.push_back(time);
+	series.value.push_back(value);
+}
+
+void dragon::EpicsSeries::encode()
+{
+	/*!
+	 * Call before writing to file: only the encoded data are persistent.
+	 */
+	decode();
+	sort();
+
+	fChannels.clear();
+	fCounts.clear();
+	fTimeCodes.clear();
+	fValues.clear();
+	for(std::map<int32_t, Series>::const_iterator it = fSeries.begin(); it != fSeries.end(); ++it) {
+		const Series& series = it->second;
+		fChannels.push_back(it->first);
+		fCounts.push_back(series.time.size());
+
+		uint32_t previous = 0;
+		for(size_t i=0; i< series.time.size(); ++i) {
+			dutils::put_varint(fTimeCodes, series.time[i] - previous);
+			previous = series.time[i];
+		}
+		fValues.insert(fValues.end(), series.value.begin(), series.value.end());
+	}
+}
+
+std::vector<int32_t> dragon::EpicsSeries::channels() const
+{
+	/*! \returns Channel numbers, in ascending order */
+	decode();
+	std::vector<int32_t> out;
+	for(std::map<int32_t, Series>::const_iterator it = fSeries.begin(); it != fSeries.end(); ++it)
+		out.push_back(it->first);
+	return out;
+}
+
+int dragon::EpicsSeries::size(int32_t ch) const
+{
+	/*! \returns Number of readings of channel `ch` (zero if there are none) */
+	const Series* series = find(ch);
+	return series ? series->time.size() : 0;
+}
+
+double dragon::EpicsSeries::value_at(int32_t ch, double time) const
+{
+	/*!
+	 * \param ch Channel number
+	 * \param time Time at which to look up the value
+	 * \returns Value of the last reading of `ch` at or before `time`, or
+	 *  dragon::NoData<double> if there is no such reading.
+	 */
+	const Series* series = find(ch);
+	if(!series) return dragon::NoData<double>::value();
+	const std::vector<uint32_t>::const_iterator it =
+		std::upper_bound(series->time.begin(), series->time.end(), time, time_after);
+	if(it == series->time.begin()) return dragon::NoData<double>::value();
+	return series->value[it - series->time.begin() - 1];
+}
+
+int dragon::EpicsSeries::count(int32_t ch, double t0, double t1) const
+{
+	/*!
+	 * \param ch Channel number
+	 * \param t0 Start of the interval (included)
+	 * \param t1 End of the interval (excluded)
+	 */
+	const Series* series = find(ch);
+	if(!series) return 0;
+	int first, last;
+	range(*series, t0, t1, first, last);
+	return last - first;
+}
+
+double dragon::EpicsSeries::average(int32_t ch, double t0, double t1) const
+{
+	/*!
+	 * \param ch Channel number
+	 * \param t0 Start of the interval (included)
+	 * \param t1 End of the interval (excluded)
+	 * \returns Mean of the readings of `ch` in `[t0, t1)`, or
+	 *  dragon::NoData<double> if there are none.
+	 */
+	const Series* series = find(ch);
+	if(!series) return dragon::NoData<double>::value();
+	int first, last;
+	range(*series, t0, t1, first, last);
+	if(first == last) return dragon::NoData<double>::value();
+
+	double sum = 0;
+	for(int i = first; i < last; ++i)
+		sum += series->value[i];
+	return sum / (last - first);
+}
+
+double dragon::EpicsSeries::stddev(int32_t ch, double t0, double t1, double mean) const
+{
+	/*!
+	 * \param ch Channel number
+	 * \param t0 Start of the interval (included)
+	 * \param t1 End of the interval (excluded)
+	 * \param mean Mean value in the interval, from average()
+	 * \returns Standard deviation of the readings of `ch` in `[t0, t1)`, or
+	 *  dragon::NoData<double> if there are none.
+	 */
+	const Series* series = find(ch);
+	if(!series) return dragon::NoData<double>::value();
+	int first, last;
+	range(*series, t0, t1, first, last);
+	if(first == last) return dragon::NoData<double>::value();
+
+	double sum2 = 0;
+	for(int i = first; i < last; ++i)
+		sum2 += (series->value[i] - mean) * (series->value[i] - mean);
+	return sqrt(sum2 / (last - first));
+}
+
+const dragon::EpicsSeries::Series* dragon::EpicsSeries::find(int32_t ch) const
+{
+	decode();
+	sort();
+	std::map<int32_t, Series>::const_iterator it = fSeries.find(ch);
+	return it == fSeries.end() ? 0 : &(it->second);
+}
+
+void dragon::EpicsSeries::range(const Series& series, double t0, double t1, int& first, int& last) const
+{
+	const std::vector<uint32_t>::const_iterator begin = series.time.begin();
+	first = std::lower_bound(begin, series.time.end(), t0, time_before) - begin;
+	last  = std::lower_bound(begin + first, series.time.end(), t1, time_before) - begin;
+	if(last < first) last = first;
+}
+
+void dragon::EpicsSeries::decode() const
+{
+	/*!
+	 * Rebuilds the per-channel series from fChannels, fCounts, fTimeCodes and
+	 * fValues. Inconsistent encoded data are reported and the affected
+	 * channels are dropped.
+	 */
+	if(fDecoded) return;
+	fDecoded = true;
+	fSorted = true;
+	fSeries.clear();
+
+	size_t pos = 0, ivalue = 0;
+	for(size_t ich = 0; ich < fChannels.size() && ich < fCounts.size(); ++ich) {
+		Series& series = fSeries[fChannels[ich]];
+		series.time.resize(fCounts[ich]);
+		series.value.resize(fCounts[ich]);
+
+		uint32_t time = 0;
+		for(int i=0; i< fCounts[ich]; ++i) {
+			uint32_t delta;
+			if(!dutils::get_varint(fTimeCodes, pos, delta) || ivalue >= fValues.size()) {
+				dutils::Error("dragon::EpicsSeries::decode", __FILE__, __LINE__)
+					<< "Truncated data at channel " << fChannels[ich] << ", reading " << i
+					<< "; readings from this one on are lost.";
+				fSeries.erase(fChannels[ich]);
+				return;
+			}
+			time += delta;
+			series.time[i] = time;
+			series.value[i] = fValues[ivalue++];
+		}
+	}
+}
+
+void dragon::EpicsSeries::sort() const
+{
+	if(fSorted) return;
+	fSorted = true;
+	for(std::map<int32_t, Series>::iterator it = fSeries.begin(); it != fSeries.end(); ++it) {
+		Series& series = it->second;
+		std::vector<std::pair<uint32_t, float> > readings(series.time.size());
+		for(size_t i=0; i< readings.size(); ++i)
+			readings[i] = std::make_pair(series.time[i], series.value[i]);
+		std::stable_sort(readings.begin(), readings.end(), time_less);
+		for(size_t i=0; i< readings.size(); ++i) {
+			series.time[i] = readings[i].first;
+			series.value[i] = readings[i].second;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+///
+/// \file EpicsSeries.hxx
+/// \author G. Christian
+/// \brief Defines a per-channel time series store for EPICS readings
+///
+#ifndef HAVE_DRAGON_EPICS_SERIES_HXX
+#define HAVE_DRAGON_EPICS_SERIES_HXX
+#include <map>
+#include <vector>
+#include "utils/IntTypes.h"
+
+#ifdef USE_ROOT
+#include <TNamed.h>
+#endif
+
+namespace dragon {
+
+class Epics;
+
+/// Columnar store of EPICS readings, one time series per channel
+/*!
+ * dragon::Epics holds a single (channel, value) reading per event, so the `t20`
+ * tree has one entry per reading and looking at one channel over time means
+ * scanning the whole tree. This class keeps the readings of each channel in
+ * contiguous, time-ordered arrays instead, so that the value at a given time
+ * or the average over a time interval is a binary search away:
+ * \code
+ * dragon::EpicsSeries* series = (dragon::EpicsSeries*)file->Get("epicsseries");
+ * double p = series->value_at(0, tstart + 60); // channel 0 one minute into the run
+ * double pavg = series->average(0, tstart, tstart + 120);
+ * \endcode
+ *
+ * `mid2root` fills one of these alongside the `t20` tree and writes it to the
+ * output file as "epicsseries". On disk, the timestamps of each channel are
+ * stored as differences from the previous reading, packed into variable-length
+ * integers (one byte for gaps under two minutes); values are stored as-is.
+ * The packed form is made by encode() and unpacked on the first query after
+ * reading from file.
+ *
+ * Times are MIDAS event timestamps (seconds). Readings of a channel are kept in
+ * time order; readings with equal timestamps keep the order they were added in.
+ */
+class EpicsSeries
+#ifdef USE_ROOT
+	: public TNamed
+#endif
+{
+public: // Methods
+	/// Empty store
+	EpicsSeries();
+	/// Remove all readings
+	void clear();
+	/// Add the reading contained in an EPICS event
+	void add(const dragon::Epics& epics);
+	/// Add a single reading
+	void add(int32_t ch, uint32_t time, float value);
+	/// Pack all readings into the (persistent) encoded form
+	void encode();
+	/// List of channels with at least one reading
+	std::vector<int32_t> channels() const;
+	/// Number of readings of a channel
+	int size(int32_t ch) const;
+	/// Value of a channel at a given time
+	double value_at(int32_t ch, double time) const;
+	/// Number of readings of a channel in a time interval
+	int count(int32_t ch, double t0, double t1) const;
+	/// Average value of a channel in a time interval
+	double average(int32_t ch, double t0, double t1) const;
+	/// Standard deviation of a channel's values in a time interval
+	double stddev(int32_t ch, double t0, double t1, double mean) const;
+
+private: // Subclasses
+	/// Time series of a single channel
+	struct Series {
+		/// Reading timestamps, ascending
+		std::vector<uint32_t> time;
+		/// Reading values, same order as time
+		std::vector<float> value;
+	};
+
+private: // Methods
+	/// Find the (sorted) series of a channel, NULL if there is none
+	const Series* find(int32_t ch) const;
+	/// Index range of readings with `t0 <= time < t1`
+	void range(const Series& series, double t0, double t1, int& first, int& last) const;
+	/// Fill the series from the encoded form, if not done yet
+	void decode() const;
+	/// Put all series in time order, if needed
+	void sort() const;
+
+private: // Data
+	/// Channel numbers, in ascending order
+	std::vector<int32_t> fChannels;
+	/// Number of readings of each channel in fChannels
+	std::vector<int32_t> fCounts;
+	/// Time differences of all readings, as little-endian base-128 integers
+	std::vector<uint8_t> fTimeCodes;
+	/// Values of all readings, channel by channel
+	std::vector<float> fValues;
+	/// Per-channel time series
+	mutable std::map<int32_t, Series> fSeries; //!
+	/// Tells if the encoded data have been unpacked into fSeries
+	mutable bool fDecoded; //!
+	/// Tells if all series are in time order
+	mutable bool fSorted; //!
+
+#ifdef USE_ROOT
+	ClassDef(dragon::EpicsSeries, 1);
+#endif
+};
+
+} // namespace dragon
+
+
+#endif
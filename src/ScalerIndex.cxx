@@ -0,0 +1,161 @@
+///
+/// \file ScalerIndex.cxx
+/// \author G. Christian
+/// \brief Implements ScalerIndex.hxx
+///
+#include <algorithm>
+#include "utils/ErrorDragon.hxx"
+#include "utils/VarInt.hxx"
+#include "ScalerIndex.hxx"
+
+namespace dutils = dragon::utils;
+
+
+namespace {
+
+/// Compares a timestamp to a (fractional) time, for lower_bound()
+inline bool time_before(uint32_t time, double t)
+{ return time < t; }
+
+} // namespace
+
+
+// ====================== Class dragon::ScalerIndex ====================== //
+
+dragon::ScalerIndex::ScalerIndex():
+	fTotal(MAX_CHANNELS, 0), fDecoded(false)
+{
+	/*!
+	 * \note Objects read from file are default constructed too, then ROOT fills
+	 *  in the encoded data; leaving fDecoded false makes the first query decode it.
+	 */
+}
+
+void dragon::ScalerIndex::clear()
+{
+	/*! Removes both the running totals and their encoded form. */
+	fTimeCodes.clear();
+	fCountCodes.clear();
+	fTime.clear();
+	fTotal.assign(MAX_CHANNELS, 0);
+	fDecoded = true;
+}
+
+void dragon::ScalerIndex::add(uint32_t time, const dragon::Scaler& scaler)
+{
+	/*!
+	 * \param time Timestamp of the scaler event
+	 * \param scaler Unpacked scaler event
+	 *
+	 * Reads are expected in time order. A read timestamped before the previous
+	 * one is reported, and indexed at the previous read's time.
+	 */
+	decode();
+	if(!fTime.empty() && time < fTime.back()) {
+		dutils::Warning("dragon::ScalerIndex::add", __FILE__, __LINE__)
+			<< "Read at time " << time << " is earlier than the previous one (" << fTime.back()
+			<< "), indexing it at " << fTime.back() << ".";
+		time = fTime.back();
+	}
+	fTime.push_back(time);
+
+	const size_t last = fTotal.size() - MAX_CHANNELS;
+	for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+		fTotal.push_back(fTotal[last + ch] + scaler.count[ch]);
+}
+
+void dragon::ScalerIndex::encode()
+{
+	/*!
+	 * Call before writing to file: only the encoded data are persistent.
+	 */
+	decode();
+	fTimeCodes.clear();
+	fCountCodes.clear();
+
+	uint32_t previous = 0;
+	for(size_t i=0; i< fTime.size(); ++i) {
+		dutils::put_varint(fTimeCodes, fTime[i] - previous);
+		previous = fTime[i];
+		for(int ch = 0; ch < MAX_CHANNELS; ++ch) {
+			const size_t k = i*MAX_CHANNELS + ch;
+			dutils::put_varint(fCountCodes, fTotal[k + MAX_CHANNELS] - fTotal[k]);
+		}
+	}
+}
+
+int dragon::ScalerIndex::size() const
+{
+	decode();
+	return fTime.size();
+}
+
+double dragon::ScalerIndex::begin_time() const
+{
+	/*! \returns Timestamp of the first read, zero if there are none */
+	decode();
+	return fTime.empty() ? 0 : fTime.front();
+}
+
+double dragon::ScalerIndex::end_time() const
+{
+	/*! \returns Timestamp of the last read, zero if there are none */
+	decode();
+	return fTime.empty() ? 0 : fTime.back();
+}
+
+uint64_t dragon::ScalerIndex::counts(int ch, double t0, double t1) const
+{
+	/*!
+	 * \param ch Scaler channel
+	 * \param t0 Start of the window (included)
+	 * \param t1 End of the window (excluded)
+	 * \returns Sum of `count[ch]` over the reads timestamped in `[t0, t1)`
+	 */
+	if(ch < 0 || ch >= MAX_CHANNELS) {
+		dutils::Error("dragon::ScalerIndex::counts", __FILE__, __LINE__)
+			<< "Invalid channel number: " << ch << ". Valid arguments are 0 <= ch < " << MAX_CHANNELS;
+		return 0;
+	}
+	const int first = find(t0);
+	const int last  = std::max(first, find(t1));
+	return fTotal[last*MAX_CHANNELS + ch] - fTotal[first*MAX_CHANNELS + ch];
+}
+
+int dragon::ScalerIndex::find(double t) const
+{
+	decode();
+	return std::lower_bound(fTime.begin(), fTime.end(), t, time_before) - fTime.begin();
+}
+
+void dragon::ScalerIndex::decode() const
+{
+	/*!
+	 * Rebuilds read times and running totals from fTimeCodes and fCountCodes.
+	 * Inconsistent encoded data are reported, and the reads from there on dropped.
+	 */
+	if(fDecoded) return;
+	fDecoded = true;
+	fTime.clear();
+	fTotal.assign(MAX_CHANNELS, 0);
+
+	size_t tpos = 0, cpos = 0;
+	uint32_t time = 0;
+	while(tpos < fTimeCodes.size()) {
+		uint32_t delta;
+		uint64_t count[MAX_CHANNELS];
+		bool success = dutils::get_varint(fTimeCodes, tpos, delta);
+		for(int ch = 0; success && ch < MAX_CHANNELS; ++ch)
+			success = dutils::get_varint(fCountCodes, cpos, count[ch]);
+		if(!success) {
+			dutils::Error("dragon::ScalerIndex::decode", __FILE__, __LINE__)
+				<< "Truncated data at read " << fTime.size() << "; reads from this one on are lost.";
+			return;
+		}
+		time += delta;
+		fTime.push_back(time);
+		const size_t last = fTotal.size() - MAX_CHANNELS;
+		for(int ch = 0; ch < MAX_CHANNELS; ++ch)
+			fTotal.push_back(fTotal[last + ch] + count[ch]);
+	}
+}
@@ -0,0 +1,93 @@
+///
+/// \file ScalerIndex.hxx
+/// \author G. Christian
+/// \brief Defines a cumulative-count index of scaler reads, for time-window integrals
+///
+#ifndef HAVE_DRAGON_SCALER_INDEX_HXX
+#define HAVE_DRAGON_SCALER_INDEX_HXX
+#include <vector>
+#include "utils/IntTypes.h"
+#include "Dragon.hxx"
+
+#ifdef USE_ROOT
+#include <TNamed.h>
+#endif
+
+namespace dragon {
+
+/// Running totals of a scaler's counts, for integrating over time windows
+/*!
+ * Holds the timestamp of every read of one scaler (head, tail or aux), and for
+ * each channel the total of the dragon::Scaler::count values up to and including
+ * each read. The number of counts between two times is then the difference of
+ * two totals, found by binary search, independent of the number of reads:
+ * \code
+ * dragon::Scaler::Index* index =
+ *   (dragon::Scaler::Index*)file->Get(dragon::Scaler::index_name("tail"));
+ * uint64_t n = index->counts(3, index->begin_time(), index->begin_time() + 120);
+ * \endcode
+ *
+ * `mid2root` writes one index per scaler tree, named after the tree's branch
+ * with "index" appended ("schindex", "sctindex", "scxindex", see
+ * dragon::Scaler::index_name()). On disk, the
+ * read times (as differences from the previous read) and the per-read counts
+ * are stored as base-128 variable-length integers; the running totals are
+ * rebuilt on the first query after reading from file.
+ *
+ * A read's counts are those accumulated since the previous read, and are
+ * attributed to the read's timestamp.
+ */
+class ScalerIndex
+#ifdef USE_ROOT
+	: public TNamed
+#endif
+{
+public: // Constants
+	/// Number of scaler channels
+	static const int MAX_CHANNELS = dragon::Scaler::MAX_CHANNELS; //!
+
+public: // Methods
+	/// Empty index
+	ScalerIndex();
+	/// Remove all reads
+	void clear();
+	/// Add a scaler read
+	void add(uint32_t time, const dragon::Scaler& scaler);
+	/// Pack all reads into the (persistent) encoded form
+	void encode();
+	/// Number of reads
+	int size() const;
+	/// Timestamp of the first read
+	double begin_time() const;
+	/// Timestamp of the last read
+	double end_time() const;
+	/// Number of counts in a channel from reads in a time window
+	uint64_t counts(int ch, double t0, double t1) const;
+
+private: // Methods
+	/// Index of the first read at or after time `t`
+	int find(double t) const;
+	/// Fill the running totals from the encoded form, if not done yet
+	void decode() const;
+
+private: // Data
+	/// Time differences between reads, as base-128 integers
+	std::vector<uint8_t> fTimeCodes;
+	/// Counts of all channels, read by read, as base-128 integers
+	std::vector<uint8_t> fCountCodes;
+	/// Read timestamps
+	mutable std::vector<uint32_t> fTime; //!
+	/// Running totals, `fTotal[read*MAX_CHANNELS + ch]` (before the read), plus a final row
+	mutable std::vector<uint64_t> fTotal; //!
+	/// Tells if the encoded data have been unpacked
+	mutable bool fDecoded; //!
+
+#ifdef USE_ROOT
+	ClassDef(dragon::ScalerIndex, 1);
+#endif
+};
+
+} // namespace dragon
+
+
+#endif
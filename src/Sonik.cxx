@@ -90,16 +90,29 @@ void Sonik::read_data(const vme::V785 adcs[], const vme::V1190& tdc)
 	 * Copies adc data into \c this->ecal[] with channel and module mapping taken
 	 * from variables.adc.channel and variables.adc.modules
 	 *
-	 * Delegates work to dutils::channel_map()
-	 * \param [in] adcs Array of vme::V785 adc modules from which data can be taken
+	 * The adc mapping is done through \c fAdcPlan, which is (re)built here whenever the
+	 * mapping in variables.adc has changed since it was built; tdc mapping is delegated
+	 * to dutils::channel_map()
+	 * \param [in] adcs Array of dragon::Tail::NUM_ADC vme::V785 adc modules from which data can be taken
 	 * \param [in] tdc vme::V1190 tdc module from which data can be read
 	 */
-	dutils::channel_map(ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs);
+	if(!fAdcPlan.is_current(this)) build_plan(adcs);
+	fAdcPlan.gather(adcs, this);
 	dutils::channel_map(thit, variables.tdc.channel, tdc);
 	dutils::channel_map(tcal0, variables.tdc0.channel, tdc);
 	trf.read_data(tdc);
 }
 
+void Sonik::build_plan(const vme::V785 adcs[])
+{
+	/*!
+	 * Resolves variables.adc.channel and variables.adc.module into \c fAdcPlan,
+	 * for an array of dragon::Tail::NUM_ADC modules. Called from read_data().
+	 */
+	fAdcPlan.clear();
+	fAdcPlan.add(this, ecal, MAX_CHANNELS, variables.adc.channel, variables.adc.module, adcs, dragon::Tail::NUM_ADC);
+}
+
 void Sonik::calculate()
 {
 	/*!
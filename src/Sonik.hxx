@@ -35,6 +35,9 @@ public: // Methods
 	void calculate();
 	/// Set variables
 	bool set_variables(midas::Database* db);
+private:
+	/// Build the ADC gather plan from the variables, for the tail ADC array
+	void build_plan(const vme::V785 adcs[]);
 public:
 	/// Calibrated energy signals
 	double ecal[MAX_CHANNELS]; //#
@@ -81,6 +84,8 @@ public: // Subclasses
 public: // Subclass instances
 	/// Instance of Dsssd::Variables
 	Sonik::Variables variables; //!
+	/// ADC channel mapping of ecal[], see build_plan()
+	dragon::utils::GatherPlan<vme::V785> fAdcPlan; //!
 };
 
 
@@ -85,8 +85,29 @@ bool vme::Io32::unpack(const midas::Event& event, const char* bankName, bool rep
 
 // ================ Class vme::V1190 ================ //
 
+namespace {
+const char* const gV1190ErrorMessages[vme::V1190::NUM_ERROR_CODES] = {
+	"Hit lost in group 0 from read-out FIFO overflow.",
+	"Hit lost in group 0 from L1 buffer overflow",
+	"Hit error have been detected in group 0.",
+	"Hit lost in group 1 from read-out FIFO overflow.",
+	"Hit lost in group 1 from L1 buffer overflow",
+	"Hit error have been detected in group 1.",
+	"Hit data lost in group 2 from read-out FIFO overflow.",
+	"Hit lost in group 2 from L1 buffer overflow",
+	"Hit error have been detected in group 2.",
+	"Hit lost in group 3 from read-out FIFO overflow.",
+	"Hit lost in group 3 from L1 buffer overflow",
+	"Hit error have been detected in group 3.",
+	"Hits rejected because of programmed event size limit",
+	"Event lost (trigger FIFO overflow).",
+	"Internal fatal chip error has been detected."
+}; }
+
 vme::V1190::V1190():
-	fMessagePeriod(0)
+	fMessagePeriod(0),
+	fErrorCounts("TDC error", "vme::V1190::handle_error_buffer", gV1190ErrorMessages,
+							 NUM_ERROR_CODES, __FILE__, __LINE__)
 {
 	///
 	reset();
@@ -157,6 +178,8 @@ void vme::V1190::reset()
 	dutils::reset_data
 		(type, extended_trigger, n_ch, count, word_count, trailer_word_count,
 		 event_id, bunch_id, status, error);
+	n_errors = 0;
+	error_mask = 0;
 }
 
 int32_t vme::V1190::get_data(int16_t ch) const
@@ -249,43 +272,22 @@ void vme::V1190::unpack_footer_buffer(const uint32_t* const pbuffer, const char*
 void vme::V1190::handle_error_buffer(const uint32_t* const pbuffer, const char* bankName)
 {
 	/*!
-	 * Error encoding is handled with a bitmask, bits 0 - 13. Here we print the
-	 * appropriate messages as given in the V1190 manual and set the `error` flag
-	 * to the corresponding code.
+	 * Error encoding is handled with a bitmask, bits 0 - 13. Here we set the `error`
+	 * flag to the corresponding code, record the code in `error_mask`, and bump the
+	 * per-module counter. Messages (as given in the V1190 manual) are only formatted
+	 * the first time each code occurs, see dragon::utils::ErrorCounterTable.
 	 * \param [in] pbuffer Pointer to the error buffer longword
 	 * \param [in] bankName Name of the MIDAS bank containing the data in question
 	 */
-	std::string errors[15] = {
-		"Hit lost in group 0 from read-out FIFO overflow.",
-		"Hit lost in group 0 from L1 buffer overflow",
-		"Hit error have been detected in group 0.",
-		"Hit lost in group 1 from read-out FIFO overflow.",
-		"Hit lost in group 1 from L1 buffer overflow",
-		"Hit error have been detected in group 1.",
-		"Hit data lost in group 2 from read-out FIFO overflow.",
-		"Hit lost in group 2 from L1 buffer overflow",
-		"Hit error have been detected in group 2.",
-		"Hit lost in group 3 from read-out FIFO overflow.",
-		"Hit lost in group 3 from L1 buffer overflow",
-		"Hit error have been detected in group 3.",
-		"Hits rejected because of programmed event size limit",
-		"Event lost (trigger FIFO overflow).",
-		"Internal fatal chip error has been detected."
-	};
+	const uint32_t bits = *pbuffer & READ14;
+	if(!bits) return;
 
+	++n_errors;
+	error_mask |= bits;
 	for(int i=0; i< 14; ++i) {
-		if((*pbuffer >> i) & READ1) {
+		if((bits >> i) & READ1) {
 			error = i; // set error code
-
-			dutils::ADelayedMessagePrinter* msg = dutils::gDelayedMessageFactory.Get(this, i);
-			if(!msg) {
-				std::stringstream temp;
-				temp << "TDC error (bank \"" << bankName << "\", addr " << this << "): " << errors[i];
-				msg = dutils::gDelayedMessageFactory.Register<dutils::Error>
-					(this, i, "vme::V1190::handle_error_buffer", fMessagePeriod, __FILE__, __LINE__, temp.str().c_str());
-			}
-
-			if(msg) msg->Incr();
+			fErrorCounts.Incr(i, bankName, fMessagePeriod);
 		}
 	}
 }
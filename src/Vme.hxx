@@ -9,6 +9,7 @@
 #include <map>
 #include <vector>
 #include "utils/Valid.hxx"
+#include "utils/ErrorDragon.hxx"
 
 
 namespace midas { class Event; }
@@ -91,6 +92,8 @@ public: // Constants
 	static const uint16_t EXTENDED_TRIGGER_TIME = 0x11;
 	/// Number of data channels available in the TDC
 	static const uint16_t MAX_CHANNELS          = 64;
+	/// Number of error codes defined for an error buffer
+	static const int NUM_ERROR_CODES            = 15;
 
 	/// Hit types (leading or trailing edge)
 	enum HitType { LEADING, TRAILING };
@@ -131,9 +134,15 @@ public: // Data
 	int32_t extended_trigger;
 	/// Error flag
 	int16_t error;
+	/// Number of error buffers in the event
+	int16_t n_errors;
+	/// Bitmask of the error codes seen in the event (bit `i` set for code `i`)
+	uint16_t error_mask;
 
 	/// Error message printing period
 	int fMessagePeriod; //!
+	/// Cumulative error counts, reported through gDelayedMessageFactory
+	dragon::utils::ErrorCounterTable fErrorCounts; //!
 
 private: // Internal routines
   /// Unpack a generic V1190 buffer
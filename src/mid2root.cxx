@@ -6,10 +6,14 @@
 ///  root file.
 ///
 #ifdef USE_ROOT
+#include <map>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <fstream>
 #include <memory>
 #include <cassert>
+#include <ctime>
 #include <algorithm>
 #include <iostream>
 #include <TTree.h>
@@ -18,11 +22,16 @@
 #include <TError.h>
 #include <TString.h>
 #include <TSystem.h>
+#include <RConfigure.h>
 #include "midas/libMidasInterface/TMidasFile.h"
 #include "midas/Database.hxx"
 #include "utils/definitions.h"
+#include "utils/OutputProfile.hxx"
+#include "utils/NTupleWriter.hxx"
 #include "Unpack.hxx"
 #include "Dragon.hxx"
+#include "EpicsSeries.hxx"
+#include "ScalerIndex.hxx"
 #include "Sonik.hxx"
 
 
@@ -30,8 +39,8 @@
 namespace {
   bool arg_return = false;
   const char* const msg_use =
-	"usage: mid2root <input file> [-o <output file>] [-v <xml odb>] [-histos <*.xml> ] "
-	"[--singles] [--overwrite] [--quiet <n>] [--help]\n";
+	"usage: mid2root <input file> [-o <output file>] [-v <xml odb>] [-histos <*.xml> ...] [--histos-only] "
+	"[--singles] [--disable <detectors>] [--compact-odb] [--compact-coinc] [--profile <name>] [--threads <n>] [--rntuple] [--follow] [--overwrite] [--quiet <n>] [--help]\n";
 }
 
 //
@@ -124,11 +133,19 @@ namespace m2r {
 	std::string fIn;
 	std::string fOut;
 	std::string fOdb;
-	std::string fHistos;
+	std::vector<std::string> fHistos;
+	std::string fProfile;
 	bool fOverwrite;
 	bool fSingles;
 	bool fSonik;
-	Options_t(): fOverwrite(false), fSingles(false), fSonik(false) {}
+	bool fCompactOdb;
+	bool fCompactCoinc;
+	bool fNTuple;
+	bool fFollow;
+	bool fHistosOnly;
+	uint32_t fDisable;
+	int fThreads;
+	Options_t(): fProfile("default"), fOverwrite(false), fSingles(false), fSonik(false), fCompactOdb(false), fCompactCoinc(false), fNTuple(false), fFollow(false), fHistosOnly(false), fDisable(0), fThreads(1) {}
   };
 
 
@@ -152,9 +169,62 @@ namespace m2r {
 	m2r::flush(m2r::cout);
   }
 
+  /// Seconds between saves of the trees in --follow mode
+  const int kFollowSaveInterval = 10;
+
+  /// Seconds without new events after which --follow mode gives up
+  const int kFollowTimeout = 600;
+
+  /// Save the trees so that other processes can read them while they are filled
+  void autosave(TTree* const* trees, int ntrees, TTree* t0)
+  {
+	for(int i=0; i< ntrees; ++i)
+      if(trees[i]) trees[i]->AutoSave("SaveSelf");
+	if(t0) t0->AutoSave("SaveSelf");
+  }
+
+  /// Waits between polls of a growing input file, backing off while nothing arrives
+  class Follower {
+  public:
+	/// Start polling quickly
+	Follower(): fDelay(kMinDelay), fIdle(0) { }
+	/// Sleep before the next poll, \returns false once kFollowTimeout has passed without new events
+	bool Wait()
+	{
+      gSystem->Sleep(fDelay);
+      fIdle += fDelay;
+      fDelay = 2*fDelay < kMaxDelay ? 2*fDelay : kMaxDelay;
+      return fIdle < 1000*kFollowTimeout;
+	}
+	/// New events arrived: poll quickly again
+	void Reset() { fDelay = kMinDelay; fIdle = 0; }
+
+  private:
+	static const int kMinDelay = 10;   // ms
+	static const int kMaxDelay = 2000; // ms
+	int fDelay;
+	int fIdle;
+  };
+
   /// Fill histograms
   void fill_histos(int eventCode, void*);
 
+  /// Object from which the histograms of an event read its data (NULL if none)
+  void* histo_data(int eventCode);
+
+  /// Object to unpack an event into
+  /*!
+   * When filling histograms, this is the object they read from, so that events
+   * are unpacked in place and never copied for the histograms; otherwise, it
+   * is \e local.
+   */
+  template <class T>
+  T& event_storage(int eventCode, T& local, bool histos)
+  {
+	void* data = histos ? histo_data(eventCode) : 0;
+	return data ? *static_cast<T*>(data) : local;
+  }
+
   /// Save histograms
   void save_histos(TDirectory*, TDirectory*);
 
@@ -199,6 +269,14 @@ namespace m2r {
       "\t                  The XML file format should be the same as those created by ROOTBEER. If the DRAGON\n"
       "\t                  package was compiled with USE_ROOTBEER turned off, then this option is not available.\n"
       "\t                  In case it is specified but not available, the program will terminate with an error message.\n"
+      "\t                  May be given more than once to fill the histograms of several files in one pass over the\n"
+      "\t                  data; a histogram with the same name as one in an earlier file replaces it.\n"
+      "\n"
+      "\t--histos-only:    Fill and save the histograms given with \"-histos\", without creating any trees (or\n"
+      "\t                  RNTuples). The output file holds the histograms, EPICS series, scaler indices and ODB\n"
+      "\t                  trees. Derived quantities (e.g. the sorted BGO energies or the MCP position) that no\n"
+      "\t                  histogram file mentions are not calculated. Combine with \"--disable\" to skip\n"
+      "\t                  calculating detectors no histogram uses.\n"
       "\n"
       "\t--sonik:          Unpack in \"SONIK\" mode. Treat tail data as if coming from the SONIK scattering detectors,\n"
       "\t                  rather than from the DRAGON end detectors.\n"
@@ -207,6 +285,43 @@ namespace m2r {
       "\t                  event only. In this mode, the buffering in a queue and timestamp matching routines are\n"
       "\t                  skipped completely.\n"
       "\n"
+      "\t--disable <detectors>: Skip processing of the specified tail detectors, and remove their branches\n"
+      "\t                  from the tail and coincidence trees, so they are absent from the output file. Followed\n"
+      "\t                  by a comma-separated list of detectors from \"dsssd\", \"ic\", \"nai\", \"ge\". With an\n"
+      "\t                  output profile of split level 0 the branches cannot be removed, and the detectors are\n"
+      "\t                  written with default values. Detectors can also be disabled in the ODB through the\n"
+      "\t                  bitmask \"/dragon/tail/variables/enable\" (this only skips processing).\n"
+      "\n"
+      "\t--compact-odb:    Save the ODB trees (\"odbstart\", \"odbstop\", \"variables\") in compact binary\n"
+      "\t                  form instead of as XML text. They are then read back from the output file without\n"
+      "\t                  parsing, which is much faster, but only by versions of this package that know the\n"
+      "\t                  compact form.\n"
+      "\n"
+      "\t--compact-coinc:  Save only the coincidence parameters (\"xtrig\", \"xtofh\", \"xtoft\") and the serial\n"
+      "\t                  numbers of the head and tail events in the coincidence tree (\"t5\"), instead of\n"
+      "\t                  copies of the head and tail events, which are already in \"t1\" and \"t3\". Use\n"
+      "\t                  dragon::FriendCoinc() to attach them, e.g. for t5->Draw(\"head.bgo.esort[0]\").\n"
+      "\n"
+      "\t--profile <name>: Choose the branch layout and compression of the output trees. Built-in profiles are\n"
+      "\t                  \"default\" (ROOT defaults), \"quicklook\" (LZ4, no VME module branches) and \"archive\"\n"
+      "\t                  (ZSTD or LZMA, large baskets). Profiles can also be read from an XML file, given as\n"
+      "\t                  \"file.xml\" (first profile in the file) or \"file.xml:name\"; see dragon::OutputProfile.\n"
+      "\n"
+      "\t--threads <n>:    Compress the output baskets of all trees on <n> threads (0: one per core), using\n"
+      "\t                  ROOT implicit multithreading. Unpacking and filling stay on the main thread, and the\n"
+      "\t                  output is the same as with one thread (the default). Requires ROOT 6 built with \"imt\".\n"
+      "\n"
+      "\t--rntuple:        Write the events (\"t1\" to \"t7\" and \"t20\") as RNTuples instead of TTrees, with the\n"
+      "\t                  same names and with columns named as the tree leaves (e.g. \"head.bgo.esort\"). Read\n"
+      "\t                  them with RDataFrame, e.g. through dragon::MakeFrame(). Only the compression of the\n"
+      "\t                  output profile applies, and disabled detectors are written as empty columns.\n"
+      "\t                  Requires ROOT 6.34 or later. The SONIK tree (\"t0\") is always a TTree.\n"
+      "\n"
+      "\t--follow:         Convert a run that is still being written: wait for new events at the end of the\n"
+      "\t                  input file instead of stopping, and finish at the end-of-run event (or after\n"
+      "\t                  10 minutes without new events). Trees are saved every 10 seconds, and whenever\n"
+      "\t                  the input runs dry, so the output file can be read while it is being written.\n"
+      "\n"
       "\t--overwrite:      Overwrite any existing output files without asking the user.\n"
       "\n"
       "\t--quiet <n>:      Suppress program output messages. Followed by a numeral specifying the level of\n"
@@ -222,6 +337,46 @@ namespace m2r {
   }
 
 
+  /// Tail detectors that can be disabled, with their enable bit
+  const struct { const char* fName; uint32_t fBit; } gDetectors[] = {
+	{ "dsssd", dragon::Tail::ENABLE_DSSSD },
+	{ "ic",    dragon::Tail::ENABLE_IC    },
+	{ "nai",   dragon::Tail::ENABLE_NAI   },
+	{ "ge",    dragon::Tail::ENABLE_GE    }
+  };
+  const int gNumDetectors = sizeof(gDetectors) / sizeof(gDetectors[0]);
+
+  /// Parse a comma-separated list of detector names into a mask, 0 if any is unknown
+  uint32_t parse_detectors(const std::string& list)
+  {
+	uint32_t mask = 0;
+	std::stringstream ss(list);
+	std::string name;
+	while(std::getline(ss, name, ',')) {
+      int i = 0;
+      for(; i< gNumDetectors; ++i) {
+        if(name == gDetectors[i].fName) break;
+      }
+      if(i == gNumDetectors) return 0;
+      mask |= gDetectors[i].fBit;
+	}
+	return mask;
+  }
+
+  /// Derived quantities referenced anywhere in the text of the histogram files
+  uint32_t histos_derived(const std::vector<std::string>& files)
+  {
+	uint32_t mask = 0;
+	for(size_t i=0; i< files.size(); ++i) {
+      std::ifstream ifs(files[i].c_str());
+      if(!ifs.good()) return dragon::derived::ALL;
+      std::stringstream text;
+      text << ifs.rdbuf();
+      mask |= dragon::derived::from_expression(text.str());
+	}
+	return dragon::derived::resolve(mask);
+  }
+
   /// Parse command line arguments
   int process_args(int argc, char** argv, Options_t* options)
   {
@@ -233,7 +388,8 @@ namespace m2r {
 	for(; iarg != args.end(); ++iarg) {
       if(iarg->substr(0, 2) == "--")
         continue;
-      if((iarg-1 >= args.begin()) && *(iarg-1) == "--quiet")
+      if((iarg-1 >= args.begin()) && (*(iarg-1) == "--quiet" || *(iarg-1) == "--disable" ||
+                                      *(iarg-1) == "--profile" || *(iarg-1) == "--threads"))
         continue;
       options->fIn = *iarg;
       break;
@@ -261,7 +417,10 @@ namespace m2r {
         return usage("histogram unpacking only available if compiled with USE_ROOTBEER=YES");
 #endif
         if (++iarg == args.end()) return usage("histogram xml file not specified");
-        options->fHistos = *iarg;
+        options->fHistos.push_back(*iarg);
+      }
+      else if (*iarg == "--histos-only") { // Histograms without trees
+        options->fHistosOnly = true;
       }
       else if (*iarg == "--singles") { // Singles mode
         options->fSingles = true;
@@ -269,6 +428,43 @@ namespace m2r {
       else if (*iarg == "--sonik") { // SONIK mode
         options->fSonik = true;
       }
+      else if (*iarg == "--disable") { // Disabled detectors
+        if (++iarg == args.end()) return usage("detectors to disable not specified");
+        options->fDisable = parse_detectors(*iarg);
+        if (options->fDisable == 0) {
+          TString error ("Invalid detector list \'");
+          error += iarg->c_str(); error += "\'";
+          return usage(error.Data());
+        }
+      }
+      else if (*iarg == "--compact-odb") { // Compact ODB storage
+        options->fCompactOdb = true;
+      }
+      else if (*iarg == "--compact-coinc") { // Compact coincidence tree
+        options->fCompactCoinc = true;
+      }
+      else if (*iarg == "--profile") { // Output profile
+        if (++iarg == args.end()) return usage("output profile not specified");
+        options->fProfile = *iarg;
+      }
+      else if (*iarg == "--follow") { // Follow a growing file
+        options->fFollow = true;
+      }
+      else if (*iarg == "--rntuple") { // RNTuple output
+        if (!dragon::NTupleWriter::IsAvailable())
+          return usage("RNTuple output only available with ROOT 6.34 or later");
+        options->fNTuple = true;
+      }
+      else if (*iarg == "--threads") { // Compression threads
+        if (++iarg == args.end()) return usage("number of threads not specified");
+        TString nstr = iarg->c_str();
+        if (nstr.IsDigit() == false) {
+          TString error ("Number of threads \'");
+          error += nstr; error += "\' is not an integer";
+          return usage(error.Data());
+        }
+        options->fThreads = nstr.Atoi();
+      }
       else if (*iarg == "--overwrite") { // Overwrite flag
         options->fOverwrite = true;
       }
@@ -292,6 +488,8 @@ namespace m2r {
 
 	if (options->fIn.empty()) // Didn't find input file
       return usage("no input file specified");
+	if (options->fHistosOnly && options->fHistos.empty())
+      return usage("'--histos-only' requires a histogram file ('-histos')");
 
 	return 0;
   }
@@ -369,6 +567,25 @@ namespace m2r {
       }
 	}
 
+	//
+	// Output profile
+	dragon::OutputProfile profile;
+	if (!dragon::OutputProfile::Get(options.fProfile, profile)) {
+      m2r::cerr << "Error: Invalid output profile \'" << options.fProfile << "\'.\n\n";
+      return 1;
+	}
+
+	//
+	// Basket compression threads; trees take the setting when they are created
+	if (options.fThreads != 1) {
+#ifdef R__USE_IMT
+      ROOT::EnableImplicitMT(options.fThreads);
+      m2r::cout << "\nCompressing output on " << ROOT::GetImplicitMTPoolSize() << " threads.\n";
+#else
+      m2r::cerr << "Warning: ROOT was built without implicit multithreading, ignoring \'--threads\'.\n";
+#endif
+	}
+
 	//
 	// Open output TFile
 	std::string ftitle;
@@ -400,12 +617,16 @@ namespace m2r {
 	bool fillHistos = false;
 	if(!options.fHistos.empty()) {
       fillHistos = true;
-      read_histos(options.fHistos);
+      for(size_t i=0; i< options.fHistos.size(); ++i)
+        read_histos(options.fHistos[i]);
 	}
 
 	m2r::cout
       << "\nConverting MIDAS file\n\t\'" << options.fIn << "\'\n"
-      << "into ROOT file\n\t\'" << out.Data() << "\'\n";
+      << "into ROOT file\n\t\'" << out.Data() << "\'\n"
+      << "with output profile\n\t" << profile.Describe() << "\n";
+	if(options.fHistosOnly)
+      m2r::cout << "filling histograms only (no trees).\n";
 
 	TFile fout (out.Data(), "RECREATE", ftitle.c_str());
 	if (fout.IsZombie()) {
@@ -413,21 +634,40 @@ namespace m2r {
                 << "\' for writing.\n\n";
       return 1;
 	}
+	profile.ApplyTo(&fout);
 
 	//
 	// Create TTrees, set branches, etc.
 	const int nIds = 9;
 
-	dragon::Head head;
-	dragon::Tail tail;
-	dragon::Coinc coinc;
-	dragon::Epics epics;
-	dragon::Scaler head_scaler;
-	dragon::Scaler tail_scaler;
-	dragon::Scaler aux_scaler;
-	dragon::RunParameters runpar;
-	tstamp::Diagnostics tsdiag;
-	Sonik sonik;
+	dragon::Head head_;
+	dragon::Tail tail_;
+	dragon::Coinc coinc_;
+	dragon::Epics epics_;
+	dragon::Scaler head_scaler_;
+	dragon::Scaler tail_scaler_;
+	dragon::Scaler aux_scaler_;
+	dragon::RunParameters runpar_;
+	tstamp::Diagnostics tsdiag_;
+	Sonik sonik_;
+
+	// Unpack straight into the histograms' objects if filling histograms
+	dragon::Head& head = m2r::event_storage(DRAGON_HEAD_EVENT, head_, fillHistos);
+	dragon::Tail& tail = m2r::event_storage(DRAGON_TAIL_EVENT, tail_, fillHistos);
+	dragon::Coinc& coinc = m2r::event_storage(DRAGON_COINC_EVENT, coinc_, fillHistos);
+	dragon::Epics& epics = m2r::event_storage(DRAGON_EPICS_EVENT, epics_, fillHistos);
+	dragon::Scaler& head_scaler = m2r::event_storage(DRAGON_HEAD_SCALER, head_scaler_, fillHistos);
+	dragon::Scaler& tail_scaler = m2r::event_storage(DRAGON_TAIL_SCALER, tail_scaler_, fillHistos);
+	dragon::Scaler& aux_scaler = m2r::event_storage(DRAGON_AUX_SCALER, aux_scaler_, fillHistos);
+	dragon::RunParameters& runpar = m2r::event_storage(DRAGON_RUN_PARAMETERS, runpar_, fillHistos);
+	tstamp::Diagnostics& tsdiag = m2r::event_storage(DRAGON_TSTAMP_DIAGNOSTICS, tsdiag_, fillHistos);
+	Sonik& sonik = m2r::event_storage(0, sonik_, fillHistos);
+
+	dragon::CoincLink coincLink;
+	dragon::EpicsSeries epicsSeries;
+	dragon::ScalerIndex head_index;
+	dragon::ScalerIndex tail_index;
+	dragon::ScalerIndex aux_index;
 
 	const int eventIds[nIds] = {
                                 DRAGON_HEAD_EVENT,
@@ -463,6 +703,7 @@ namespace m2r {
                         &runpar
 	};
 	void *psonik = &sonik;
+	void *pcoincLink = &coincLink;
 
 	const std::string branchNames[nIds] = {
                                            "head",
@@ -489,10 +730,12 @@ namespace m2r {
 
 	// SONIK Tree
 	TTree* trees[nIds];
+	dragon::NTupleWriter* ntuples[nIds];
 	TTree* t0 = 0;
-	if(options.fSonik) {
+	if(options.fSonik && !options.fHistosOnly) {
       t0 = new TTree("t0", "Sonik Events");
-      t0->Branch("sonik", "Sonik", &psonik);
+      profile.MakeBranch(t0, "sonik", "Sonik", &psonik);
+      profile.ApplyTo(t0);
 	}
 
 	// Normal trees
@@ -500,15 +743,64 @@ namespace m2r {
       char buf[256];
       sprintf (buf, "t%d", eventIds[i]); // n.b. TTree cleanup handled by TFile destructor
       //
-      bool makeTree = true; // always make all trees
-      if (makeTree) {
+      bool makeTree = !options.fHistosOnly; // histograms only: no trees at all
+      ntuples[i] = 0;
+      if (makeTree && options.fNTuple) {
+        trees[i] = 0;
+        if(options.fCompactCoinc && eventIds[i] == DRAGON_COINC_EVENT)
+          ntuples[i] = new dragon::NTupleWriter(buf, branchNames[i].c_str(), "dragon::CoincLink", pcoincLink, fout, profile);
+        else
+          ntuples[i] = new dragon::NTupleWriter(buf, branchNames[i].c_str(), classNames[i].c_str(), addr[i], fout, profile);
+      }
+      else if (makeTree) {
         trees[i] = new TTree(buf, eventTitles[i].c_str());
-        trees[i]->Branch(branchNames[i].c_str(), classNames[i].c_str(), &(addr[i]));
+        if(options.fCompactCoinc && eventIds[i] == DRAGON_COINC_EVENT)
+          profile.MakeBranch(trees[i], branchNames[i].c_str(), "dragon::CoincLink", &pcoincLink);
+        else
+          profile.MakeBranch(trees[i], branchNames[i].c_str(), classNames[i].c_str(), &(addr[i]));
+        profile.ApplyTo(trees[i]);
       } else {
         trees [i] = 0;
       }
 	}
 
+	//
+	// Disabled detectors: never calculated, and their branches removed from the
+	// tail & coinc trees (before the first Fill())
+	if(options.fDisable) {
+      tail.set_disabled(options.fDisable);
+      coinc.tail.set_disabled(options.fDisable);
+      const bool haveTrees = !options.fHistosOnly && !options.fNTuple;
+      if(haveTrees && profile.fSplitLevel == 0) {
+        m2r::cerr << "Warning: output profile \'" << profile.fName << "\' has split level 0, so the "
+                  << "disabled detectors cannot be left out of the trees (they are written with default values).\n";
+      }
+      else if(haveTrees) {
+        for(int i=0; i< m2r::gNumDetectors; ++i) {
+          if((options.fDisable & m2r::gDetectors[i].fBit) == 0) continue;
+          for(int j=0; j< nIds; ++j) {
+            std::string branch;
+            if(eventIds[j] == DRAGON_TAIL_EVENT)
+              branch = m2r::gDetectors[i].fName;
+            else if(eventIds[j] == DRAGON_COINC_EVENT && !options.fCompactCoinc)
+              branch = std::string("tail.") + m2r::gDetectors[i].fName;
+            else
+              continue;
+            if(trees[j]) dragon::OutputProfile::RemoveBranches(trees[j], branch);
+          }
+        }
+      }
+	}
+
+	//
+	// Histograms only: calculate just the derived quantities they use
+	if(options.fHistosOnly) {
+      const uint32_t derived = m2r::histos_derived(options.fHistos);
+      head.set_derived(derived);
+      tail.set_derived(derived);
+      coinc.set_derived(derived);
+	}
+
 	dragon::Unpacker
       unpack (&head, &tail, &coinc, &epics, &head_scaler, &tail_scaler, &aux_scaler, &runpar, &tsdiag, options.fSingles);
 
@@ -547,12 +839,33 @@ namespace m2r {
 	//
 	// Loop over events in the midas file
 	int nnn = 0;
+	m2r::Follower follower;
+	time_t lastSave = time(0);
+	bool unsaved = false;
 	while (1) {
       //
       // Read event from MIDAS file
       TMidasEvent temp;
-      bool success = fin.Read(&temp);
-      if (!success) break;
+      if (options.fFollow) {
+        int status = fin.ReadFollow(&temp);
+        if (status < 0) break;
+        if (status == 0) { // Nothing new yet: save what we have and wait
+          if (unsaved) {
+            m2r::autosave(trees, nIds, t0);
+            unsaved = false;
+            lastSave = time(0);
+          }
+          if (follower.Wait()) continue;
+          m2r::cerr << "\nWarning: No new events for " << m2r::kFollowTimeout
+                    << " seconds, and no end-of-run event. Finishing the conversion.\n";
+          break;
+        }
+        follower.Reset();
+      }
+      else {
+        bool success = fin.Read(&temp);
+        if (!success) break;
+      }
 
       //
       // Read ODB tree if MIDAS_EOR buffer
@@ -575,20 +888,36 @@ namespace m2r {
         std::vector<Int_t>::iterator it =
           std::find(which.begin(), which.end(), eventIds[i]);
         if(it != which.end()) {
-          if(trees[i]) {
-            trees[i]->Fill();
+          if(trees[i] || ntuples[i]) {
+            if(options.fCompactCoinc && eventIds[i] == DRAGON_COINC_EVENT) coincLink.set(coinc);
+            if(trees[i]) trees[i]->Fill();
+            else ntuples[i]->Fill();
           }
+          if(eventIds[i] == DRAGON_EPICS_EVENT) epicsSeries.add(epics);
+          if(eventIds[i] == DRAGON_HEAD_SCALER)  head_index.add(temp.GetTimeStamp(), head_scaler);
+          if(eventIds[i] == DRAGON_TAIL_SCALER)  tail_index.add(temp.GetTimeStamp(), tail_scaler);
+          if(eventIds[i] == DRAGON_AUX_SCALER)   aux_index.add(temp.GetTimeStamp(), aux_scaler);
           if(fillHistos) fill_histos(*it, addr[i]);
           if(options.fSonik && eventIds[i] == DRAGON_TAIL_EVENT) {
             sonik.reset();
             sonik.read_data(tail.v785, tail.v1190);
             sonik.calculate();
-            t0->Fill();
+            if(t0) t0->Fill();
             if(fillHistos) fill_histos(0, psonik);
           }
         }
       }
       m2r::static_counter (nnn++, 1000, false);
+
+      if (options.fFollow) {
+        if (temp.GetEventId() == MIDAS_EOR) break; // Run is over, finish as usual
+        unsaved = true;
+        if (time(0) - lastSave >= m2r::kFollowSaveInterval) {
+          m2r::autosave(trees, nIds, t0);
+          unsaved = false;
+          lastSave = time(0);
+        }
+      }
 	} // while (1) {
 
 	m2r::static_counter (nnn, 1000, true);
@@ -605,14 +934,18 @@ namespace m2r {
           std::vector<Int_t>::iterator it =
             std::find(which.begin(), which.end(), eventIds[i]);
           if(it != which.end()) {
-            if(trees[i]) {
-              trees[i]->Fill();
+            if(trees[i] || ntuples[i]) {
+              if(options.fCompactCoinc && eventIds[i] == DRAGON_COINC_EVENT) coincLink.set(coinc);
+              if(trees[i]) trees[i]->Fill();
+              else ntuples[i]->Fill();
             }
+            if(fillHistos) fill_histos(*it, addr[i]);
             if(options.fSonik && eventIds[i] == DRAGON_TAIL_EVENT) {
               sonik.reset();
               sonik.read_data(tail.v785, tail.v1190);
               sonik.calculate();
-              t0->Fill();
+              if(t0) t0->Fill();
+              if(fillHistos) fill_histos(0, psonik);
             }
           }
         }
@@ -634,6 +967,22 @@ namespace m2r {
         trees[i]->AutoSave();
         trees[i]->ResetBranchAddresses();
       }
+      delete ntuples[i]; // commits the RNTuple
+	}
+	//
+	// Write EPICS time series
+	epicsSeries.encode();
+	epicsSeries.SetNameTitle("epicsseries", "EPICS readings by channel.");
+	epicsSeries.Write("epicsseries");
+	//
+	// Write scaler indices
+	dragon::ScalerIndex* scalerIndex[3] = { &head_index, &tail_index, &aux_index };
+	const char* scalerNames[3] = { "head", "tail", "aux" };
+	for (int i=0; i< 3; ++i) {
+      const char* name = dragon::Scaler::index_name(scalerNames[i]);
+      scalerIndex[i]->encode();
+      scalerIndex[i]->SetNameTitle(name, "Scaler running totals.");
+      scalerIndex[i]->Write(name);
 	}
 	//
 	// Write histograms to file if requested
@@ -644,12 +993,14 @@ namespace m2r {
 	//
 	// Write run start ODB variables
 	if(db0.get()) {
+      if(options.fCompactOdb) db0->Compact();
       db0->SetNameTitle("odbstart", "ODB tree at run start.");
       db0->Write("odbstart");
 	}
 	//
 	// Write run stop ODB variables
 	if(db1.get()) {
+      if(options.fCompactOdb) db1->Compact();
       db1->SetNameTitle("odbstop", "ODB tree at run stop.");
       db1->Write("odbstop");
 
@@ -660,6 +1011,7 @@ namespace m2r {
 	//
 	// Write variables actually used in analysis
 	midas::Database db(options.fOdb.c_str());
+	if(options.fCompactOdb) db.Compact();
 	db.SetNameTitle("variables", "ODB tree used in analysis.");
 	db.Write("variables");
 	//
@@ -678,6 +1030,7 @@ namespace m2r {
 //
 // Dummy implementation for fill_histos() and save_histos()
 void m2r::fill_histos(int, void*) { assert("Can't get here!"); }
+void* m2r::histo_data(int) { return 0; }
 void m2r::read_histos(const std::string&) { assert("Can't get here!"); }
 void m2r::save_histos(TDirectory*, TDirectory*) { assert("Can't get here!"); }
 
@@ -740,6 +1093,7 @@ namespace m2r {
   class AEvent: public rb::Event {
   public:
 	virtual void SetData(const void* addr) = 0;
+	virtual void* GetData() = 0;
   };
 
   //
@@ -756,6 +1110,9 @@ namespace m2r {
 	//
 	// Copy data at an address to the data wrapper
 	void SetData(const void* addr) { *fWrapper = *reinterpret_cast<const T*>(addr); }
+	//
+	// Address of the data wrapper's object, into which main_() unpacks directly
+	void* GetData() { return fWrapper.Get(); }
   private:
 	//
 	// Required pure virtual functions - implement with nothing
@@ -810,12 +1167,31 @@ void m2r::read_histos(const std::string& fname)
   rb::ReadHistXML(fname.c_str(), "o");
 }
 
+namespace {
+  // Look up (once) the event registered for an event code
+  m2r::AEvent* get_event(int eventCode)
+  {
+    static std::map<int, m2r::AEvent*> events;
+    std::map<int, m2r::AEvent*>::iterator it = events.find(eventCode);
+    if(it == events.end())
+      it = events.insert(std::make_pair(eventCode, dynamic_cast<m2r::AEvent*>(rb::Rint::gApp()->GetEvent(eventCode)))).first;
+    return it->second;
+  }
+}
+
+void* m2r::histo_data(int eventCode)
+{
+  m2r::AEvent* event = get_event(eventCode);
+  return event ? event->GetData() : 0;
+}
+
 void m2r::fill_histos(int eventCode, void* addr)
 {
-  m2r::AEvent* event = dynamic_cast<m2r::AEvent*>(rb::Rint::gApp()->GetEvent(eventCode));
+  m2r::AEvent* event = get_event(eventCode);
   if(!event) return;
 
-  event->SetData(addr);
+  if(addr != event->GetData()) // not unpacked in place, see event_storage()
+    event->SetData(addr);
   event->GetHistManager()->FillAll();
 }
 
@@ -8,6 +8,7 @@
 #include "utils/ErrorDragon.hxx"
 #include "Odb.hxx"
 #include "Xml.hxx"
+#include "OdbTable.hxx"
 
 #ifdef USE_ROOT
 #include <RVersion.h>
@@ -22,9 +23,9 @@
 // This will disable reading of midas::Database objects from files created
 // w/ other versions, though.
 
-#define MIDAS_XML_CLASS_VERSION 4
+#define MIDAS_XML_CLASS_VERSION 6 // was 4 before the compact table
 #else
-#define MIDAS_XML_CLASS_VERSION 3
+#define MIDAS_XML_CLASS_VERSION 5 // was 3 before the compact table
 #endif
 
 #endif // #ifdef USE_ROOT
@@ -38,6 +39,14 @@ namespace midas {
  * from the ODB or a file is specified by the constructor argument, which
  * is either the path to a file containing XML data, or "online" to read
  * from the ODB.
+ *
+ * Offline databases can be converted with Compact() to a midas::OdbTable,
+ * which takes the place of the XML data. Objects written to ROOT files after
+ * that are read back without any XML parsing; the XML text is still
+ * available through Dump().
+ *
+ * Online databases can take a Snapshot() of whole ODB directories, after
+ * which reads of keys within them are served locally.
  */
 class Database
 #ifdef USE_ROOT
@@ -61,6 +70,9 @@ private:
 	/// Flag specifying 'zombie' status
 	bool fIsZombie;
 
+	/// Compact form of the XML data (used if fXml is NULL), or snapshot of the ODB if online
+	OdbTable fTable;
+
 public:
 	/// Default constructor for ROOT I/O
 	Database (): fXml(0), fIsOnline(false), fIsZombie(false)
@@ -123,11 +135,58 @@ public:
 				return;
 			}
 			if(fXml.get()) fXml->Dump(strm);
+			else fTable.Dump(strm);
 		}
 
 	/// Default dump to std::cout
 	void Dump() const { Dump(std::cout); }
 
+	/// Replace the XML data by their compact form
+	bool Compact()
+		{
+			/*!
+			 * Converts the parsed XML tree to a midas::OdbTable and frees the XML
+			 * data. Reads are unaffected, but objects written to ROOT files are
+			 * then read back without parsing. Call before writing.
+			 *
+			 * \returns true if successful (or already compact), false for online or
+			 *  zombie databases.
+			 */
+			if(fIsZombie || fIsOnline) return false;
+			if(!fXml.get()) return !fTable.Empty();
+			if(!fTable.Fill(fXml->GetOdb())) return false;
+			fXml.reset(0);
+			return true;
+		}
+
+	/// Tell if the data are in compact form
+	bool IsCompact() const { return !fXml.get() && !fTable.Empty(); }
+
+	/// Copy an ODB directory into a local snapshot
+	bool Snapshot(const char* dir)
+		{
+			/*!
+			 * \param dir Path of the ODB directory, e.g. "/dragon"
+			 * \returns true if successful, false if not online or if the copy failed
+			 *
+			 * Online databases only. Fetches the whole directory in a single
+			 * transfer, after which keys within it are read from the local copy
+			 * instead of each making its own round trip to the ODB. Values go through
+			 * the same text form as in the ODB dumps of MIDAS files. Keys not found
+			 * in the snapshot are still read from the ODB, as are arrays of strings.
+			 *
+			 * \attention The snapshot is not updated when the ODB changes: take it
+			 *  right before reading a set of values (e.g. at run start), with a
+			 *  short-lived Database.
+			 */
+			if(fIsZombie || !fIsOnline) return false;
+			std::string xml;
+			if(!Odb::CopyXml(dir, xml)) return false;
+			Xml parsed(&xml[0], xml.size());
+			if(parsed.IsZombie()) return false;
+			return fTable.Append(parsed.GetOdb(), dir);
+		}
+
 	/// Read a single value
 	template <typename T> bool ReadValue(const char* path, T& value) const
 		{
@@ -138,13 +197,16 @@ public:
 			 * \returns true if read was successful, false otherwise
 			 */
 			if(fIsZombie) return false;
-			if (fIsOnline) return Odb::ReadValue(path, value);
+			if (fIsOnline) {
+				if(fTable.FindKey(path, true) >= 0) return fTable.GetValue(path, value);
+				return Odb::ReadValue(path, value);
+			}
 			else if (fXml.get()) {
 				bool success;
 				fXml->GetValue(path, value, &success);
 				return success;
 			}
-			else return false;
+			else return fTable.GetValue(path, value);
 		}
 
 	/// Read the length of an array
@@ -155,9 +217,12 @@ public:
 			 * \returns The length of the array upon success, -1 upon failure.
 			 */
 			if      (fIsZombie)  return -1;
-			else if (fIsOnline)  return Odb::ReadArraySize(path);
+			else if (fIsOnline)  {
+				if(fTable.FindKeyArray(path, true) >= 0) return fTable.GetArrayLength(path);
+				return Odb::ReadArraySize(path);
+			}
 			else if (fXml.get()) return fXml->GetArrayLength(path);
-			else                 return -1;
+			else                 return fTable.GetArrayLength(path);
 		}
 
 	/// Read an array
@@ -171,13 +236,18 @@ public:
 			 * \returns The length of the array that was read (0 if error)
 			 */
 			if(fIsZombie) return 0;
-			if(fIsOnline) return Odb::ReadArray(path, array, length);
+			if(fIsOnline) {
+				// (string arrays are read whole from the ODB, but split at whitespace from XML)
+				if(typeid(T) != typeid(std::string) && fTable.FindKeyArray(path, true) >= 0)
+					return fTable.GetArray(path, length, array) ? length : 0;
+				return Odb::ReadArray(path, array, length);
+			}
 			else if (fXml.get()) {
 				bool success;
 				fXml->GetArray(path, length, array, &success);
 				return length;
 			}
-			else return 0;
+			else return fTable.GetArray(path, length, array) ? length : 0;
 		}
 
 	/// Print value of a parameter
@@ -192,7 +262,11 @@ public:
 				return;
 			}
 			if (!fXml.get()) {
-				std::cerr << "fXml == 0!\n";
+				bool success = fTable.PrintArray(path);
+				if(!success)   success = fTable.PrintValue(path);
+				if(!success) {
+					std::cout << "Path: \"" << path << "\" not found!\n";
+				}
 				return;
 			}
 			if(1) {
@@ -217,7 +291,7 @@ public:
 				if(!node) node = fXml->FindKeyArray(path, true);
 				return (node != 0);
 			}
-			else return false;
+			else return fTable.FindKey(path, true) >= 0 || fTable.FindKeyArray(path, true) >= 0;
 		}
 
 #ifdef USE_ROOT
@@ -10,6 +10,7 @@
 #include <cstring>
 #include <stdio.h>
 #include <stdint.h>
+#include <vector>
 #include <midas.h>
 #include "Odb.hxx"
 
@@ -278,6 +279,56 @@ int midas::Odb::WriteString(const char*name, const char* string)
   return status;
 }
 
+bool midas::Odb::CopyXml(const char*name, std::string& xml)
+{
+  /*!
+   * \param [in] name Path of the directory (or key) to copy
+   * \param [out] xml XML dump of the directory, in the format of the ODB
+   *  dumps in MIDAS files, with the directory's contents directly under the
+   *  `<odb>` element
+   * \returns true if successful
+   *
+   * The whole directory is copied in a single db_copy_xml() call, instead of
+   * one db_find_key() and db_get_data() per key.
+   */
+  int status;
+  HNDLE hdir = 0;
+  HNDLE hkey;
+  HNDLE hdb = GetHandle();
+  if (hdb == 0) return false;
+
+  status = db_find_key (hdb, hdir, (char*)name, &hkey);
+  if (status != SUCCESS)
+    {
+      dragon::utils::Error("midas::Odb::CopyXml", __FILE__, __LINE__)
+        << "Couldn't find key for path \"" << name << "\". status = " << status;
+      return false;
+    }
+
+  // Grow the buffer until the dump fits (up to 256 MB)
+  const int maxSize = 1 << 28;
+  std::vector<char> buf(1 << 20);
+  while (1)
+    {
+      int size = buf.size();
+      status = db_copy_xml(hdb, hkey, &buf[0], &size);
+      if (status != DB_TRUNCATED || (int)buf.size() >= maxSize)
+        break;
+      buf.resize(2 * buf.size());
+    }
+
+  if (status != DB_SUCCESS)
+    {
+      dragon::utils::Error("midas::Odb::CopyXml", __FILE__, __LINE__)
+        << "Cannot copy \"" << name << "\" from odb, db_copy_xml() status = " << status;
+      return false;
+    }
+
+  buf.back() = 0;
+  xml = &buf[0];
+  return true;
+}
+
 
 #else
 #include <iostream>
@@ -301,6 +352,7 @@ int midas::Odb::WriteInt(const char*name, int index, int value) { ERR_NO_MIDAS;
 int midas::Odb::WriteBool(const char*name, int index, bool value) { ERR_NO_MIDAS; return -1; }
 int midas::Odb::WriteDouble(const char*name, int index, double value) { ERR_NO_MIDAS; return -1; }
 int midas::Odb::WriteString(const char*name, const char* string) { ERR_NO_MIDAS; return -1; }
+bool midas::Odb::CopyXml(const char*name, std::string& xml) { ERR_NO_MIDAS; return false; }
 
 #undef ERR_NO_MIDAS
 
@@ -86,6 +86,9 @@ public:
   /// Write a string to the odb
 	static int WriteString(const char*name, const char* string);
 
+  /// Copy a whole odb directory, as XML
+	static bool CopyXml(const char*name, std::string& xml);
+
 #ifndef __MAKECINT__
 
 	template <typename T>
@@ -0,0 +1,364 @@
+//! \file OdbTable.cxx
+//! \author G. Christian
+//! \brief Implements OdbTable.hxx
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <algorithm>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#endif
+#include "OdbTable.hxx"
+
+
+/// Elements of all keys and key arrays, by full path
+struct midas::OdbTable::PathIndex {
+#if __cplusplus >= 201103L
+	typedef std::unordered_map<std::string, int32_t> Map_t;
+#else
+	typedef std::map<std::string, int32_t> Map_t;
+#endif
+	/// "key" elements
+	Map_t fKeys;
+	/// "keyarray" elements
+	Map_t fArrays;
+};
+
+/// Adds strings to fStrings, storing each distinct string once
+class midas::OdbTable::StringPool {
+public:
+	/// Start from the strings already stored
+	StringPool(std::vector<char>& strings): fStrings(strings)
+		{
+			for(size_t pos = 0; pos < fStrings.size(); pos += strlen(&fStrings[pos]) + 1)
+				fOffsets.insert(std::make_pair(std::string(&fStrings[pos]), int32_t(pos)));
+		}
+	/// \returns Offset of `str` in the buffer (-1 for NULL)
+	int32_t Add(const char* str)
+		{
+			if(!str) return -1;
+			std::map<std::string, int32_t>::iterator it = fOffsets.find(str);
+			if(it != fOffsets.end()) return it->second;
+			const int32_t offset = fStrings.size();
+			fStrings.insert(fStrings.end(), str, str + strlen(str) + 1);
+			fOffsets.insert(std::make_pair(std::string(str), offset));
+			return offset;
+		}
+private:
+	std::vector<char>& fStrings;
+	std::map<std::string, int32_t> fOffsets;
+};
+
+
+// ====================== Class midas::OdbTable ====================== //
+
+midas::OdbTable::OdbTable():
+	fIndex(0)
+{ }
+
+midas::OdbTable::OdbTable(const OdbTable& other):
+#ifdef USE_ROOT
+	TObject(other),
+#endif
+	fStrings(other.fStrings), fParent(other.fParent), fTag(other.fTag),
+	fValue(other.fValue), fAttributeBegin(other.fAttributeBegin),
+	fAttributes(other.fAttributes), fIndex(0)
+{ }
+
+midas::OdbTable& midas::OdbTable::operator= (const OdbTable& other)
+{
+	if(this == &other) return *this;
+#ifdef USE_ROOT
+	TObject::operator=(other);
+#endif
+	fStrings = other.fStrings;
+	fParent = other.fParent;
+	fTag = other.fTag;
+	fValue = other.fValue;
+	fAttributeBegin = other.fAttributeBegin;
+	fAttributes = other.fAttributes;
+	delete fIndex;
+	fIndex = 0;
+	return *this;
+}
+
+midas::OdbTable::~OdbTable()
+{
+	delete fIndex;
+}
+
+void midas::OdbTable::Reset()
+{
+	fStrings.clear();
+	fParent.clear();
+	fTag.clear();
+	fValue.clear();
+	fAttributeBegin.clear();
+	fAttributes.clear();
+	delete fIndex;
+	fIndex = 0;
+}
+
+bool midas::OdbTable::Fill(const XmlNode* odb)
+{
+	/*!
+	 * \param odb The `<odb>` node of a parsed tree, e.g. midas::Xml::GetOdb()
+	 *
+	 * Replaces any existing data.
+	 */
+	Reset();
+	if(!odb) return false;
+
+	StringPool pool(fStrings);
+	AddTree(odb, -1, pool);
+	fAttributeBegin.push_back(fAttributes.size());
+	return true;
+}
+
+bool midas::OdbTable::Append(const XmlNode* odb, const char* dir)
+{
+	/*!
+	 * \param odb The `<odb>` node of a parsed tree holding the contents of an
+	 *  ODB directory, as written by `db_copy_xml()`
+	 * \param dir Full path of the directory, e.g. "/Equipment"
+	 * \returns false if \e odb is NULL
+	 *
+	 * Adds the children of \e odb under new "dir" elements for each part of
+	 * \e dir, so that their paths are the same as in the ODB. Starts a new tree
+	 * if the table is empty.
+	 */
+	if(!odb) return false;
+
+	if(!fAttributeBegin.empty()) fAttributeBegin.pop_back(); // end position
+	StringPool pool(fStrings);
+	int32_t parent = 0;
+	if(Empty()) {
+		AddElement(-1, "odb", pool);
+		fAttributes.push_back(pool.Add("root"));
+		fAttributes.push_back(pool.Add("/"));
+	}
+	std::stringstream parts(dir);
+	std::string part;
+	while(std::getline(parts, part, '/')) {
+		if(part.empty()) continue;
+		parent = AddElement(parent, "dir", pool);
+		fAttributes.push_back(pool.Add("name"));
+		fAttributes.push_back(pool.Add(part.c_str()));
+	}
+	for(const XmlNode* child = odb->child; child; child = child->next)
+		AddTree(child, parent, pool);
+	fAttributeBegin.push_back(fAttributes.size());
+
+	delete fIndex;
+	fIndex = 0;
+	return true;
+}
+
+int32_t midas::OdbTable::AddElement(int32_t parent, const char* tag, StringPool& pool)
+{
+	/*!
+	 * Adds an element with no value and no attributes yet (attributes are added
+	 * by appending them to fAttributes).
+	 */
+	const int32_t element = fParent.size();
+	fParent.push_back(parent);
+	fTag.push_back(pool.Add(tag));
+	fValue.push_back(-1);
+	fAttributeBegin.push_back(fAttributes.size());
+	return element;
+}
+
+void midas::OdbTable::AddTree(const XmlNode* top, int32_t parent, StringPool& pool)
+{
+	/*! Adds an XML node and all elements below it, in document order. */
+	std::vector<std::pair<const XmlNode*, int32_t> > stack(1, std::make_pair(top, parent));
+	while(!stack.empty()) {
+		const XmlNode* node = stack.back().first;
+		const int32_t element = AddElement(stack.back().second, node->name, pool);
+		stack.pop_back();
+
+		fValue.back() = pool.Add(node->value);
+		for(int i=0; i< 2*node->n_attributes; ++i)
+			fAttributes.push_back(pool.Add(node->attributes[i]));
+
+		// Children in reverse, so that they come off the stack in document order
+		const size_t first = stack.size();
+		for(const XmlNode* child = node->child; child; child = child->next)
+			stack.push_back(std::make_pair(child, element));
+		std::reverse(stack.begin() + first, stack.end());
+	}
+}
+
+std::string midas::OdbTable::GetXml() const
+{
+	/*!
+	 * Writes the elements back through the MXML writer, with the same layout as
+	 * mxml_write_tree().
+	 */
+	if(Empty()) return "";
+
+	MXML_WRITER* writer = mxml_open_buffer();
+	std::vector<int32_t> open;
+	for(int32_t element = 0; element < (int32_t)fParent.size(); ++element) {
+		while(!open.empty() && open.back() != fParent[element]) {
+			mxml_end_element(writer);
+			open.pop_back();
+		}
+		const int32_t parent = fParent[element];
+		if(parent < 0 || fValue[parent] < 0 || element != parent + 1)
+			mxml_start_element(writer, String(fTag[element]));
+		else
+			mxml_start_element_noindent(writer, String(fTag[element]));
+		for(int32_t i = fAttributeBegin[element]; i < fAttributeBegin[element + 1]; i += 2)
+			mxml_write_attribute(writer, String(fAttributes[i]), String(fAttributes[i + 1]));
+		if(fValue[element] >= 0)
+			mxml_write_value(writer, String(fValue[element]));
+		open.push_back(element);
+	}
+	for(; !open.empty(); open.pop_back())
+		mxml_end_element(writer);
+
+	char* buffer = mxml_close_buffer(writer);
+	std::string out(buffer ? buffer : "");
+	free(buffer);
+	return out;
+}
+
+void midas::OdbTable::Dump(std::ostream& strm) const
+{
+	strm << GetXml();
+}
+
+int32_t midas::OdbTable::FindKey(const char* path, bool silent) const
+{
+	int32_t out = FindPath(path, false);
+	if(out < 0 && !silent) {
+		dragon::utils::Error("midas::OdbTable::FindKey")
+			<< "Error: ODB path: " << path << " was not found.";
+	}
+	return out;
+}
+
+int32_t midas::OdbTable::FindKeyArray(const char* path, bool silent) const
+{
+	int32_t out = FindPath(path, true);
+	if(out < 0 && !silent) {
+		dragon::utils::Error("midas::OdbTable::FindKeyArray")
+			<< "Error: ODB path: " << path << " was not found.";
+	}
+	return out;
+}
+
+int midas::OdbTable::GetArrayLength(const char* path) const
+{
+	/*!
+	 * \param [in] path "Directory" path of the array
+	 * \returns Length of the array if valid, -1 if error.
+	 */
+	if(Empty()) return -1;
+	int32_t key = FindKeyArray(path);
+	if(key < 0) return -1;
+	return GetNumValues(key, path, "midas::OdbTable::GetArrayLength");
+}
+
+bool midas::OdbTable::PrintValue(const char* path) const
+{
+	if(Empty()) return false;
+	int32_t key = FindKey(path, true);
+	if(key < 0) return false;
+	std::cout << path << " = " << String(fValue[key]) << "\n";
+	return true;
+}
+
+bool midas::OdbTable::PrintArray(const char* path) const
+{
+	if(Empty()) return false;
+	int32_t key = FindKeyArray(path, true);
+	if(key < 0) return false;
+	int size = GetNumValues(key, path, "midas::OdbTable::PrintArray");
+	if(size < 0) return false;
+
+	std::vector<int32_t> values;
+	GetValueElements(key, values);
+	for(int i=0; i< size; ++i) {
+		if(i >= (int)values.size()) {
+			dragon::utils::Error("midas::OdbTable::PrintArray", __FILE__, __LINE__)
+				<< "Unable to find value node for array index " << i;
+			continue;
+		}
+		std::cout << path << "[" << i << "] = " << String(fValue[values[i]]) << "\n";
+	}
+	return true;
+}
+
+const char* midas::OdbTable::GetAttribute(int32_t element, const char* name) const
+{
+	for(int32_t i = fAttributeBegin[element]; i < fAttributeBegin[element + 1]; i += 2) {
+		if(!strcmp(String(fAttributes[i]), name))
+			return String(fAttributes[i + 1]);
+	}
+	return 0;
+}
+
+int midas::OdbTable::GetNumValues(int32_t array, const char* path, const char* where) const
+{
+	const char* numValues = GetAttribute(array, "num_values");
+	if(!numValues) {
+		dragon::utils::Error(where, __FILE__, __LINE__)
+			<< "\"num_values\" attribute not found for array: " << path;
+		return -1;
+	}
+	return atoi(numValues);
+}
+
+void midas::OdbTable::GetValueElements(int32_t array, std::vector<int32_t>& values) const
+{
+	/*!
+	 * Elements are in document order, so the descendants of `array` are the
+	 * elements following it up to the first one whose parent comes before it.
+	 */
+	values.clear();
+	for(int32_t i = array + 1; i < (int32_t)fParent.size() && fParent[i] >= array; ++i) {
+		if(fParent[i] == array && !strcmp(String(fTag[i]), "value"))
+			values.push_back(i);
+	}
+}
+
+const midas::OdbTable::PathIndex& midas::OdbTable::GetIndex() const
+{
+	/*!
+	 * Paths are formed from the "name" attributes of the enclosing "dir"
+	 * elements, as in midas::Xml; of duplicate paths, the first is kept.
+	 */
+	if(fIndex) return *fIndex;
+	fIndex = new PathIndex;
+
+	// Path of each "dir" element (and of the <odb> element), with trailing '/'
+	std::vector<std::string> prefix(fParent.size());
+	std::vector<char> isDir(fParent.size(), 0);
+	if(!Empty()) isDir[0] = 1;
+
+	for(int32_t element = 1; element < (int32_t)fParent.size(); ++element) {
+		const int32_t parent = fParent[element];
+		if(!isDir[parent]) continue;
+		const char* name = GetAttribute(element, "name");
+		if(!name) continue;
+		const char* tag = String(fTag[element]);
+		if(!strcmp(tag, "dir")) {
+			isDir[element] = 1;
+			prefix[element] = prefix[parent] + name + "/";
+		}
+		else if(!strcmp(tag, "key"))
+			fIndex->fKeys.insert(std::make_pair(prefix[parent] + name, element));
+		else if(!strcmp(tag, "keyarray"))
+			fIndex->fArrays.insert(std::make_pair(prefix[parent] + name, element));
+	}
+	return *fIndex;
+}
+
+int32_t midas::OdbTable::FindPath(const char* path, bool array) const
+{
+	const PathIndex::Map_t& elements = array ? GetIndex().fArrays : GetIndex().fKeys;
+	PathIndex::Map_t::const_iterator it = elements.find(path[0] == '/' ? path + 1 : path);
+	return it == elements.end() ? -1 : it->second;
+}
@@ -0,0 +1,250 @@
+//! \file OdbTable.hxx
+//! \author G. Christian
+//! \brief Defines a compact, path-indexed binary form of ODB trees.
+#ifndef MIDAS_ODB_TABLE_HXX
+#define MIDAS_ODB_TABLE_HXX
+#include "utils/IntTypes.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <typeinfo>
+#ifndef __MAKECINT__
+#include <iostream>
+#endif
+#include "mxml.h"
+#include "XmlTree.hxx"
+
+#ifdef USE_ROOT
+#include <TObject.h>
+#endif
+
+#include "utils/ErrorDragon.hxx"
+
+
+namespace midas {
+
+/// Compact binary form of an ODB tree, for storage in ROOT files
+/*!
+ * Holds the elements of an `<odb>` XML tree as flat arrays (parent, tag,
+ * attributes and value of each element, in document order), with all strings
+ * pooled and stored once. Reading one back from a ROOT file involves no XML
+ * parsing: the first lookup builds a hash table from full key paths to
+ * elements in a single pass over the arrays, and values are then converted
+ * straight from the pooled strings.
+ *
+ * Values are kept as the text of the XML file, so reads give exactly the
+ * same results as through midas::Xml, and the XML is reconstructed unchanged
+ * (up to formatting) by Dump().
+ *
+ * This is the storage used by midas::Database objects after
+ * midas::Database::Compact() has been called.
+ */
+class OdbTable
+#ifdef USE_ROOT
+	: public TObject
+#endif
+{
+public:
+	/// Empty table
+	OdbTable();
+
+	/// Copy data (the path index is rebuilt on demand)
+	OdbTable(const OdbTable& other);
+
+	/// Assign data (the path index is rebuilt on demand)
+	OdbTable& operator= (const OdbTable& other);
+
+	/// Frees the path index
+	~OdbTable();
+
+	/// \brief Fill from the `<odb>` node of a parsed XML tree
+	/// \returns false if \e odb is NULL
+	bool Fill(const XmlNode* odb);
+
+	/// \brief Add the contents of an ODB directory, from the `<odb>` node of its XML dump
+	/// \returns false if \e odb is NULL
+	bool Append(const XmlNode* odb, const char* dir);
+
+	/// Remove all data
+	void Reset();
+
+	/// Tells if there are no data
+	bool Empty() const { return fParent.empty(); }
+
+	/// Reconstruct the XML text of the tree
+	std::string GetXml() const;
+
+	/// Write the XML text of the tree to an output stream
+	void Dump(std::ostream& strm) const;
+
+	/// TObject has a virtual function Dump() as well, so implement it here
+	void Dump() const { Dump(std::cout); }
+
+	/// \brief Find the element of a key
+	/// \param [in] path "Directory" path of the key, e.g. "/Experiment/Run Parameters/Comment"
+	/// \param [in] silent Do not report a missing path
+	/// \returns Element index, -1 if not found
+	int32_t FindKey(const char* path, bool silent = false) const;
+
+	/// \brief Find the element of a key array
+	/// \param [in] path "Directory" path of the array, e.g. "/dragon/bgo/variables/adc/channel"
+	/// \param [in] silent Do not report a missing path
+	/// \returns Element index, -1 if not found
+	int32_t FindKeyArray(const char* path, bool silent = false) const;
+
+	/// Read the value of a key
+	template <typename T> bool GetValue(const char* path, T& value) const
+		{
+			/*!
+			 * \param [in] path "Directory" path of the key
+			 * \param [out] value Set to the value of the key
+			 * \returns true if \e path was found, false otherwise
+			 */
+			if(Empty()) return false;
+			int32_t key = FindKey(path);
+			if(key < 0) return false;
+			ConvertValue(String(fValue[key]), value);
+			return true;
+		}
+
+	/// Read the length of a key array
+	int GetArrayLength(const char* path) const;
+
+	/// Read the values of a key array
+	template <typename T> bool GetArray(const char* path, int length, T* array) const
+		{
+			/*!
+			 * \param [in] path "Directory" path of the array
+			 * \param [in] length Length of the array to fill
+			 * \param [out] array Array to fill with the values
+			 * \returns true if \e path was found with \e length values, false otherwise
+			 */
+			if(Empty()) return false;
+			int32_t key = FindKeyArray(path);
+			if(key < 0) return false;
+			int size = GetNumValues(key, path, "midas::OdbTable::GetArray");
+			if(size < 0) return false;
+			if(size != length) {
+				dragon::utils::Error("midas::OdbTable::GetArray", __FILE__, __LINE__)
+					<< "size of the ODB array " << path << ": " << size
+					<< " is not equal to the size of the array to fill: " << length;
+				return false;
+			}
+
+			std::vector<int32_t> values;
+			GetValueElements(key, values);
+			for(int i=0; i< size; ++i) {
+				if(i >= (int)values.size()) {
+					dragon::utils::Error("midas::OdbTable::GetArray", __FILE__, __LINE__)
+						<< "Unable to find value node for array index " << i;
+					continue;
+				}
+				ConvertElement(String(fValue[values[i]]), array[i]);
+			}
+			return true;
+		}
+
+	/// Print the value of a key
+	bool PrintValue(const char* path) const;
+
+	/// Print the values of a key array
+	bool PrintArray(const char* path) const;
+
+private:
+	/// Full paths of keys and key arrays, built on the first lookup
+	struct PathIndex;
+
+	/// Pool of the strings in fStrings, while adding elements
+	class StringPool;
+
+	/// Add an element, returning its index
+	int32_t AddElement(int32_t parent, const char* tag, StringPool& pool);
+
+	/// Add an XML node and its descendants
+	void AddTree(const XmlNode* node, int32_t parent, StringPool& pool);
+
+	/// String at an offset of fStrings ("" for -1)
+	const char* String(int32_t offset) const
+		{ return offset < 0 ? "" : &fStrings[offset]; }
+
+	/// Value of an attribute of an element, NULL if it has none
+	const char* GetAttribute(int32_t element, const char* name) const;
+
+	/// Read the "num_values" attribute of a key array, -1 (with an error message) if missing
+	int GetNumValues(int32_t array, const char* path, const char* where) const;
+
+	/// Collect the "value" children of a key array, in order
+	void GetValueElements(int32_t array, std::vector<int32_t>& values) const;
+
+	/// Build the path index, if not done yet
+	const PathIndex& GetIndex() const;
+
+	/// Look up the element of a key (or key array) in the path index, -1 if not there
+	int32_t FindPath(const char* path, bool array) const;
+
+	/// Convert a key value as midas::Xml::GetValue() does
+	template <typename T> static void ConvertValue(const char* str, T& value)
+		{
+			std::stringstream val;
+			val << str;
+			val >> value;
+		}
+
+	/// Convert an array value as midas::Xml::GetArray() does
+	template <typename T> static void ConvertElement(const char* str, T& value)
+		{
+			if(typeid(T) != typeid(bool)) {
+				std::stringstream val;
+				val << str;
+				val >> value;
+			}
+			else {
+				value = (!strcmp("y", str)) ? true : false;
+			}
+		}
+
+private:
+	/// All strings (tags, attributes, values), each NUL-terminated and stored once
+	std::vector<char> fStrings;
+	/// Parent of each element (-1 for the `<odb>` element), in document order
+	std::vector<int32_t> fParent;
+	/// Offset of each element's tag in fStrings
+	std::vector<int32_t> fTag;
+	/// Offset of each element's value in fStrings (-1 if it has none)
+	std::vector<int32_t> fValue;
+	/// Position of each element's first attribute in fAttributes, plus the end position
+	std::vector<int32_t> fAttributeBegin;
+	/// Offsets of attribute names and values in fStrings, in pairs
+	std::vector<int32_t> fAttributes;
+	/// Path index
+	mutable PathIndex* fIndex; //!
+
+public:
+#ifdef USE_ROOT
+	ClassDef(midas::OdbTable, 1);
+#endif
+};
+
+#ifndef __MAKECINT__
+
+/// Template specialization for bool
+template <>
+inline void midas::OdbTable::ConvertValue<bool>(const char* str, bool& value)
+{
+	value = (!strcmp("y", str)) ? true : false;
+}
+
+/// Template specialization for std::string
+template <>
+inline void midas::OdbTable::ConvertValue<std::string>(const char* str, std::string& value)
+{
+	value = str;
+}
+
+#endif
+
+} // namespace midas
+
+
+#endif
@@ -10,6 +10,14 @@
 #include <sstream>
 #include <vector>
 #include <iostream>
+#include <map>
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#endif
+#include <sys/stat.h>
+#include "utils/definitions.h"
+#include "midas/libMidasInterface/TMidasFile.h"
+#include "midas/libMidasInterface/TMidasEvent.h"
 #include "Xml.hxx"
 
 #ifdef USE_ROOT
@@ -17,8 +25,146 @@
 #include <TString.h>
 #endif
 
+
+namespace {
+
+/// Parsed XML file shared by all Xml instances opened from it
+struct CachedFile {
+	/// Modification time of the file when parsed
+	time_t fMtime;
+	/// Size of the file when parsed
+	off_t fSize;
+	/// Parsed tree (one reference held by the cache)
+	midas::XmlTree* fTree;
+	/// XML text, copied into each instance for Dump() and ROOT I/O
+	std::vector<char> fBuffer;
+};
+
+/// Cached files, by path
+std::map<std::string, CachedFile>& file_cache()
+{
+	static std::map<std::string, CachedFile> cache;
+	return cache;
+}
+
+/// Reference counts of trees shared through the cache
+/*! Trees not in here belong to a single instance. */
+std::map<midas::XmlTree*, int>& tree_refs()
+{
+	static std::map<midas::XmlTree*, int> refs;
+	return refs;
+}
+
+/// Nodes of all keys and key arrays of a tree, by full path
+struct PathIndex {
+#if __cplusplus >= 201103L
+	typedef std::unordered_map<std::string, midas::XmlNode*> Map_t;
+#else
+	typedef std::map<std::string, midas::XmlNode*> Map_t;
+#endif
+	/// "key" nodes
+	Map_t fKeys;
+	/// "keyarray" nodes
+	Map_t fArrays;
+};
+
+/// Path indices, by tree
+std::map<midas::XmlTree*, PathIndex*>& path_indices()
+{
+	static std::map<midas::XmlTree*, PathIndex*> indices;
+	return indices;
+}
+
+/// Record all keys & arrays below a "dir" node
+/*! The first of duplicate paths is kept, as a path query would find. */
+void index_dir(midas::XmlNode* dir, const std::string& prefix, PathIndex* index)
+{
+	for(midas::XmlNode* child = dir->child; child; child = child->next) {
+		const char* name = child->GetAttribute("name");
+		if(!name) continue;
+		if(!strcmp(child->name, "dir"))
+			index_dir(child, prefix + name + "/", index);
+		else if(!strcmp(child->name, "key"))
+			index->fKeys.insert(std::make_pair(prefix + name, child));
+		else if(!strcmp(child->name, "keyarray"))
+			index->fArrays.insert(std::make_pair(prefix + name, child));
+	}
+}
+
+/// Get the path index of a tree, building it if needed
+PathIndex* get_path_index(midas::XmlTree* tree, midas::XmlNode* odb)
+{
+	std::map<midas::XmlTree*, PathIndex*>::iterator it = path_indices().find(tree);
+	if(it != path_indices().end())
+		return it->second;
+	PathIndex* index = new PathIndex;
+	index_dir(odb, "", index);
+	path_indices()[tree] = index;
+	return index;
+}
+
+/// Look up a path in one of the index maps
+midas::XmlNode* find_path(const PathIndex::Map_t& nodes, const char* path)
+{
+	PathIndex::Map_t::const_iterator it = nodes.find(path[0] == '/' ? path + 1 : path);
+	return it == nodes.end() ? 0 : it->second;
+}
+
+/// Drop one reference to a tree, freeing it (and its path index) with the last one
+void release_tree(midas::XmlTree* tree)
+{
+	std::map<midas::XmlTree*, int>::iterator it = tree_refs().find(tree);
+	if(it != tree_refs().end() && --(it->second) > 0)
+		return;
+	if(it != tree_refs().end())
+		tree_refs().erase(it);
+
+	std::map<midas::XmlTree*, PathIndex*>::iterator index = path_indices().find(tree);
+	if(index != path_indices().end()) {
+		delete index->second;
+		path_indices().erase(index);
+	}
+	delete tree;
+}
+
+/// Parse XML text into a new tree, NULL on error
+midas::XmlTree* parse_tree(const char* text, size_t length, char* error, int error_size, int* error_line)
+{
+	midas::XmlTree* tree = new midas::XmlTree;
+	if(tree->Parse(text, length, error, error_size, error_line))
+		return tree;
+	delete tree;
+	return 0;
+}
+
+/// Check if a string ends with a given suffix
+bool has_suffix(const char* str, const char* suffix)
+{
+	const size_t len = strlen(str), slen = strlen(suffix);
+	return len >= slen && !strcmp(str + len - slen, suffix);
+}
+
+/// Check if a file is MIDAS data (compressed, or starting with a begin-of-run event)
+bool is_midas_file(const char* file_name)
+{
+	if(has_suffix(file_name, ".gz") || has_suffix(file_name, ".bz2"))
+		return true;
+
+	FILE* f = fopen(file_name, "rb");
+	if(!f) return false;
+	unsigned char head[4];
+	const size_t nRead = fread(head, 1, sizeof(head), f);
+	fclose(f);
+
+	// Little-endian event id (MIDAS_BOR) and trigger mask ("MI")
+	return nRead == sizeof(head) &&
+		(head[0] | head[1] << 8) == MIDAS_BOR && head[2] == 'M' && head[3] == 'I';
+}
+
+} // namespace
+
 midas::Xml::Xml(const char* filename):
-	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0)
+	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0), fUseIndex(true)
 {
 #ifdef USE_ROOT
 	TString fnameExp (filename);
@@ -28,6 +174,9 @@ midas::Xml::Xml(const char* filename):
 	const char* fname2 = filename ? filename : "0x0";
 #endif
 
+	if(OpenCached(fname2))
+		return;
+
 	char err[256]; int err_line;
 	fTree = ParseFile(fname2, err, sizeof(err), &err_line);
 	if(!fTree) {
@@ -37,17 +186,18 @@ midas::Xml::Xml(const char* filename):
 		fIsZombie = true;
 		return;
 	}
-	fOdb = mxml_find_node(fTree, "/odb");
+	fOdb = XmlTree::FindChild(fTree->GetRoot(), "odb");
 	if(!fOdb) {
 		dragon::utils::Error("midas::Xml::Xml")
 			<< "No odb tag found in xml file: " << fname2;
 		fIsZombie = true;
 		return;
 	}
+	AddToCache(fname2);
 }
 
 midas::Xml::Xml(char* buf, int length):
-	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0)
+	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0), fUseIndex(true)
 {
 	char err[256]; int err_line;
 	fTree = ParseBuffer(buf, length, err, sizeof(err), &err_line);
@@ -58,7 +208,7 @@ midas::Xml::Xml(char* buf, int length):
 		fIsZombie = true;
 		return;
 	}
-	fOdb = mxml_find_node(fTree, "/odb");
+	fOdb = XmlTree::FindChild(fTree->GetRoot(), "odb");
 	if(!fOdb) {
 		dragon::utils::Error("midas::Xml::Xml")
 			<< "no odb tag found in xml buffer.";
@@ -68,7 +218,7 @@ midas::Xml::Xml(char* buf, int length):
 }
 
 midas::Xml::Xml():
-	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0)
+	fTree(0), fOdb(0), fIsZombie(false), fLength(0), fBuffer(0), fUseIndex(true)
 {
 	;
 }
@@ -84,7 +234,7 @@ void midas::Xml::InitFromStreamer()
 			fIsZombie = true;
 			return;
 		}
-		fOdb = mxml_find_node(fTree, "/odb");
+		fOdb = XmlTree::FindChild(fTree->GetRoot(), "odb");
 		if(!fOdb) {
 			dragon::utils::Error("midas::Xml::InitFromStreamer")
 				<< "no odb tag found in xml buffer.";
@@ -96,21 +246,77 @@ void midas::Xml::InitFromStreamer()
 
 midas::Xml::~Xml()
 {
-	if(fTree) mxml_free_tree(fTree);
-	if(fBuffer) delete fBuffer;
+	if(fTree) release_tree(fTree);
+	if(fBuffer) delete[] fBuffer;
+}
+
+bool midas::Xml::OpenCached(const char* filename)
+{
+	/*!
+	 * \returns true if `filename` is in the cache with its current modification
+	 *  time and size, in which case fTree and fOdb are set to the cached tree and
+	 *  fBuffer to a copy of the cached XML text. A stale entry is dropped.
+	 */
+	std::map<std::string, CachedFile>::iterator it = file_cache().find(filename);
+	if(it == file_cache().end())
+		return false;
+
+	struct stat st;
+	CachedFile& cached = it->second;
+	if(stat(filename, &st) != 0 || st.st_mtime != cached.fMtime || st.st_size != cached.fSize) {
+		release_tree(cached.fTree);
+		file_cache().erase(it);
+		return false;
+	}
+
+	++tree_refs()[cached.fTree];
+	fTree = cached.fTree;
+	fOdb = XmlTree::FindChild(fTree->GetRoot(), "odb");
+	fLength = cached.fBuffer.size();
+	fBuffer = new char[fLength];
+	memcpy(fBuffer, &cached.fBuffer[0], fLength);
+	return true;
+}
+
+void midas::Xml::AddToCache(const char* filename)
+{
+	/*!
+	 * The tree becomes shared between this instance and the cache. Files that
+	 * cannot be stat'ed are not cached.
+	 */
+	struct stat st;
+	if(!fTree || !fBuffer || stat(filename, &st) != 0)
+		return;
+
+	CachedFile cached;
+	cached.fMtime = st.st_mtime;
+	cached.fSize = st.st_size;
+	cached.fTree = fTree;
+	cached.fBuffer.assign(fBuffer, fBuffer + fLength);
+	tree_refs()[fTree] = 2; // this instance & the cache
+	file_cache()[filename] = cached;
+}
+
+void midas::Xml::ClearCache()
+{
+	for(std::map<std::string, CachedFile>::iterator it = file_cache().begin(); it != file_cache().end(); ++it)
+		release_tree(it->second.fTree);
+	file_cache().clear();
 }
 
 
-midas::Xml::Node midas::Xml::ParseFile(const char* file_name, char *error, int error_size, int *error_line)
+midas::XmlTree* midas::Xml::ParseFile(const char* file_name, char *error, int error_size, int *error_line)
 {
 	char line[1000];
 	int length = 0;
-	PMXML_NODE root;
 	FILE* f;
 
 	if (error)
 		 error[0] = 0;
 
+	if (is_midas_file(file_name))
+		return ParseMidasFile(file_name, error, error_size, error_line);
+
 	f = fopen(file_name, "r");
 
 	if (!f) {
@@ -176,16 +382,26 @@ midas::Xml::Node midas::Xml::ParseFile(const char* file_name, char *error, int e
 	fBuffer[length] = 0;
 	fclose(f);
 
-	// The following lines leak memory and I am not sure why they were ever there!!
-	// if (mxml_parse_entity(&fBuffer, file_name, error, error_size, error_line) != 0) {
-	// 	// delete[] fBuffer;
-	// 	return NULL;
-	// }
+	return parse_tree(fBuffer, length, error, error_size, error_line);
+}
 
-	root = mxml_parse_buffer(fBuffer, error, error_size, error_line);
+midas::XmlTree* midas::Xml::ParseMidasFile(const char* file_name, char *error, int error_size, int *error_line)
+{
+	TMidasFile file;
+	if (!file.Open(file_name)) {
+		snprintf(error, error_size, "Unable to open MIDAS file \"%s\": %s", file_name, file.GetLastError());
+		*error_line = __LINE__;
+		return NULL;
+	}
 
-	return root;
+	TMidasEvent bor;
+	if (!file.Read(&bor) || bor.GetEventId() != MIDAS_BOR) {
+		snprintf(error, error_size, "No begin-of-run event at the start of MIDAS file \"%s\"", file_name);
+		*error_line = __LINE__;
+		return NULL;
+	}
 
+	return ParseBuffer(bor.GetData(), bor.GetDataSize(), error, error_size, error_line);
 }
 
 void midas::Xml::Dump(std::ostream& strm) const
@@ -195,38 +411,37 @@ void midas::Xml::Dump(std::ostream& strm) const
 			 << fBuffer;
 }
 
-midas::Xml::Node midas::Xml::ParseBuffer(char* buf, int length, char *error, int error_size, int *error_line)
+midas::XmlTree* midas::Xml::ParseBuffer(char* buf, int length, char *error, int error_size, int *error_line)
 {
-	fLength = length;
-	fBuffer = new char[fLength];
-	memcpy(fBuffer, buf, length);
-
-	PMXML_NODE root;
+	// Keep a NUL-terminated copy for Dump() and ROOT I/O. When called from
+	// InitFromStreamer(), `buf` is fBuffer itself, and is kept as it is if
+	// already terminated.
+	const bool terminated = length > 0 && buf[length - 1] == 0;
+	if (buf != fBuffer || !terminated) {
+		char* oldBuffer = fBuffer;
+		fLength = terminated ? length : length + 1;
+		fBuffer = new char[fLength];
+		memcpy(fBuffer, buf, length);
+		fBuffer[fLength - 1] = 0;
+		if (oldBuffer) delete[] oldBuffer;
+	}
 
 	if (error)
 		 error[0] = 0;
 
 	int startPos = 0, lodb = (int)strlen("<odb");
-	while(startPos < length + lodb) {
+	while(startPos + lodb <= length) {
 		if(!memcmp(&fBuffer[startPos], "<odb", strlen("<odb")))
 			break;
 		++startPos;
 	}
-	if(startPos == length + lodb) {
+	if(startPos + lodb > length) {
 		sprintf(error, "Could not find \"<odb\"");
 		*error_line = __LINE__;
 		return NULL;
 	}
 
-	char* pxml = &fBuffer[startPos];
-	// The following lines leak memory and I'm not sure why they were ever there!
-	// if (mxml_parse_entity(&pxml, "", error, error_size, error_line) != 0) {
-	// 	return NULL;
-	// }
-
-	root = mxml_parse_buffer(pxml, error, error_size, error_line);
-
-	return root;
+	return parse_tree(&fBuffer[startPos], length - startPos, error, error_size, error_line);
 }
 
 
@@ -254,21 +469,29 @@ inline std::vector<std::string> path_tokenize(const char* path) {
 	nodes.push_back(strPath);
 	return nodes;
 }
-std::string get_xml_path(const char* path, const char* node_type) {
-	const char* pPath = path[0] == '/' ? &path[1] : &path[0];
-	std::vector<std::string> nodes = path_tokenize(pPath);
-	std::stringstream xmlPath;
-	for(std::vector<std::string>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-		if(it != nodes.end() - 1) xmlPath << "/dir[@name=" << *it << "]";
-		else xmlPath << "/" << node_type << "[@name=" << *it << "]";
+midas::XmlNode* find_node(midas::XmlNode* dir, const std::vector<std::string>& names, size_t depth, const char* node_type) {
+	// Searches all directories of the same name, in order, as a path query would
+	const bool last = (depth + 1 == names.size());
+	for(midas::XmlNode* child = dir->child; child; child = child->next) {
+		if(strcmp(child->name, last ? node_type : "dir")) continue;
+		const char* name = child->GetAttribute("name");
+		if(!name || names[depth] != name) continue;
+		midas::XmlNode* found = last ? child : find_node(child, names, depth + 1, node_type);
+		if(found) return found;
 	}
-	return xmlPath.str();
+	return 0;
+}
+midas::XmlNode* find_node(midas::XmlNode* odb, const char* path, const char* node_type) {
+	const char* pPath = path[0] == '/' ? &path[1] : &path[0];
+	return find_node(odb, path_tokenize(pPath), 0, node_type);
 } }
 
 midas::Xml::Node midas::Xml::FindKey(const char* path, bool silent)
 {
 	if(!Check()) return 0;
-	Node out = mxml_find_node(fOdb, get_xml_path(path, "key").c_str());
+	Node out = fUseIndex ?
+		find_path(get_path_index(fTree, fOdb)->fKeys, path) :
+		find_node(fOdb, path, "key");
 	if(!out && !silent) {
 		dragon::utils::Error("midas::Xml::FindKey")
 			<< "Error: XML path: " << path << " was not found.";
@@ -279,7 +502,9 @@ midas::Xml::Node midas::Xml::FindKey(const char* path, bool silent)
 midas::Xml::Node midas::Xml::FindKeyArray(const char* path, bool silent)
 {
 	if(!Check()) return 0;
-	Node out = mxml_find_node(fOdb, get_xml_path(path, "keyarray").c_str());
+	Node out = fUseIndex ?
+		find_path(get_path_index(fTree, fOdb)->fArrays, path) :
+		find_node(fOdb, path, "keyarray");
 	if(!out && !silent) {
 		dragon::utils::Error("midas::Xml::FindKey")
 			<< "Error: XML path: " << path << " was not found.";
@@ -287,3 +512,11 @@ midas::Xml::Node midas::Xml::FindKeyArray(const char* path, bool silent)
 	return out;
 }
 
+void midas::Xml::GetValueNodes(Node array, std::vector<Node>& values)
+{
+	values.clear();
+	for(Node child = array->child; child; child = child->next) {
+		if(!strcmp(child->name, "value"))
+			values.push_back(child);
+	}
+}
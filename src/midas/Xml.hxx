@@ -12,8 +12,8 @@
 #ifndef __MAKECINT__
 #include <iostream>
 #endif
-#include "mxml.h"
 #include "strlcpy.h"
+#include "XmlTree.hxx"
 
 #ifdef USE_ROOT
 #include <TObject.h>
@@ -39,11 +39,11 @@ class Xml
 {
 public:
 	/// Pointer to an XML node.
-	typedef PMXML_NODE Node;
+	typedef XmlNode* Node;
 
 public:// private:
-	/// Pointer to the entire XML tree contained within a file
-	Node fTree; //!
+	/// The entire XML tree contained within a file
+	XmlTree* fTree; //!
 	/// Pointer to the ODB portion of fTree
 	Node fOdb;  //!
 	/// Flag specifying if the file was invalid
@@ -52,6 +52,8 @@ public:// private:
 	uint32_t fLength;
 	/// Buffer containing all of the XML data
 	char* fBuffer; //[fLength]
+	/// Flag specifying if path lookups go through the path index
+	bool fUseIndex; //!
 
 public:
 	/// \brief Default constructor for ROOTCINT
@@ -61,19 +63,36 @@ public:
 	/// \details Parses a file containing XML data to fill fTree and fOdb.
 	/// Can handle either a dedicated \c .xml file or a \c .mid (or any other) file containing
 	/// the XML data as a subset.
-	/// \note Memory is allocated only to fTree, fOdb and any other subnodes used later
-	/// simply refer to memory locations relative to fTree.
+	/// \note Memory is allocated only to fTree, fOdb and any other nodes used later
+	/// simply refer to memory held by fTree.
 	Xml(const char* filename);
 
 	/// \brief Read data from a buffer w/ XML data
 	Xml(char* buf, int length);
 
-	/// Frees resources allocated to fTree
+	/// Frees fTree (unless shared through the file cache)
 	~Xml();
 
+	/// \brief Enable or disable the path index
+	/// \details By default, the first lookup walks the whole tree once and records the node
+	/// of every key and key array under its full path, so that all lookups are then a single
+	/// hash table search instead of an XML path query. The index is shared by all instances
+	/// using the same (cached) tree. Disabling it makes every lookup an XML path query.
+	void SetUseIndex(bool use) { fUseIndex = use; }
+
+	/// \brief Release all parsed files held by the file cache
+	/// \details Xml(const char*) parses each file once per process and shares the parsed
+	/// tree with every later instance opened from the same path, as long as the file's
+	/// modification time and size are unchanged. This drops the cache's references
+	/// (trees still used by existing instances stay alive until those are deleted).
+	static void ClearCache();
+
 	/// Returns fIsZombie
 	bool IsZombie() { return fIsZombie; }
 
+	/// Returns fOdb, parsing fBuffer first if needed (NULL if the XML data are invalid)
+	Node GetOdb() { return Check() ? fOdb : 0; }
+
 	/// Dump buffer to an output stream
 	void Dump(std::ostream& strm) const;
 
@@ -161,7 +180,7 @@ public:
 				return;
 			}
 			array.clear();
-			char* pAttribute = mxml_get_attribute(node, "num_values");
+			const char* pAttribute = node->GetAttribute("num_values");
 			if(!pAttribute) {
 				dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 					<< "\"num_values\" attribute not found for array: " << path;
@@ -169,10 +188,10 @@ public:
 				return;
 			}
 			int size = atoi(pAttribute);
+			std::vector<Node> valNodes;
+			GetValueNodes(node, valNodes);
 			for(int i=0; i< size; ++i) {
-				std::stringstream valPath;
-				valPath << "/value[" << i+1 << "]";
-				Node valNode = mxml_find_node(node, valPath.str().c_str());
+				Node valNode = i < (int)valNodes.size() ? valNodes[i] : 0;
 				if(!valNode) {
 					dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 						<< "Unable to find value node for array index " << i;
@@ -203,7 +222,7 @@ public:
 			 */
 			Node node = FindKeyArray(path);
 			if(!node) return -1;
-			char* pAttribute = mxml_get_attribute(node, "num_values");
+			const char* pAttribute = node->GetAttribute("num_values");
 			if(!pAttribute) {
 				dragon::utils::Error("midas::Xml::GetArrayLength", __FILE__, __LINE__)
 					<< "\"num_values\" attribute not found for array: " << path;
@@ -231,7 +250,7 @@ public:
 				if(success) *success = false;
 				return;
 			}
-			char* pAttribute = mxml_get_attribute(node, "num_values");
+			const char* pAttribute = node->GetAttribute("num_values");
 			if(!pAttribute) {
 				dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 					<< "\"num_values\" attribute not found for array: " << path;
@@ -247,10 +266,10 @@ public:
 				return;
 			}
 
+			std::vector<Node> valNodes;
+			GetValueNodes(node, valNodes);
 			for(int i=0; i< size; ++i) {
-				std::stringstream valPath;
-				valPath << "/value[" << i+1 << "]";
-				Node valNode = mxml_find_node(node, valPath.str().c_str());
+				Node valNode = i < (int)valNodes.size() ? valNodes[i] : 0;
 				if(!valNode) {
 					dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 						<< "Unable to find value node for array index " << i;
@@ -278,17 +297,17 @@ public:
 			if(!node) {
 				return false;
 			}
-			char* pAttribute = mxml_get_attribute(node, "num_values");
+			const char* pAttribute = node->GetAttribute("num_values");
 			if(!pAttribute) {
 				dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 					<< "\"num_values\" attribute not found for array: " << path;
 				return false;
 			}
 			int size = atoi(pAttribute);
+			std::vector<Node> valNodes;
+			GetValueNodes(node, valNodes);
 			for(int i=0; i< size; ++i) {
-				std::stringstream valPath;
-				valPath << "/value[" << i+1 << "]";
-				Node valNode = mxml_find_node(node, valPath.str().c_str());
+				Node valNode = i < (int)valNodes.size() ? valNodes[i] : 0;
 				if(!valNode) {
 					dragon::utils::Error("midas::Xml::GetArray", __FILE__, __LINE__)
 						<< "Unable to find value node for array index " << i;
@@ -314,12 +333,17 @@ private:
 	/// \brief Helper function to parse a file containing XML data and set fTree and fObd
 	/// \note Most of the implementation was a paraphrase of mxml_parse_file() in midas.c,
 	/// extended to handle files that contain the XML data only as a subset (i.e. MIDAS files).
-	Node ParseFile(const char* file_name, char *error, int error_size, int *error_line);
+	XmlTree* ParseFile(const char* file_name, char *error, int error_size, int *error_line);
+
+	/// \brief Helper function to parse the ODB dump in the begin-of-run event of a MIDAS file
+	/// \details Reads only the first event through TMidasFile, so compressed (.gz, .bz2)
+	/// files work too, and the cost does not depend on the size of the run.
+	XmlTree* ParseMidasFile(const char* file_name, char *error, int error_size, int *error_line);
 
 	/// \brief Helper function to parse a buffer containing XML data and set fTree and fObd
-	/// \note Most of the implementation was a paraphrase of mxml_parse_file() in midas.c,
-	/// extended to handle files that contain the XML data only as a subset (i.e. MIDAS files).
-	Node ParseBuffer(char* buf, int length, char *error, int error_size, int *error_line);
+	/// \details Copies the buffer into fBuffer, which is kept for Dump() and ROOT I/O, and
+	/// parses it from the `<odb` tag on with midas::XmlTree.
+	XmlTree* ParseBuffer(char* buf, int length, char *error, int error_size, int *error_line);
 
 	/// \brief Parse XML tree stored in fBuffer
 	/// \details This is to be used for when we write a class instance to a ROOT file.
@@ -337,6 +361,15 @@ private:
 	/// \brief Check if fTree and fOdb are non-null
 	bool Check();
 
+	/// \brief Collect the "value" children of a key array node, in order
+	void GetValueNodes(Node array, std::vector<Node>& values);
+
+	/// \brief Share the parsed tree of a cached file, if it is up to date
+	bool OpenCached(const char* filename);
+
+	/// \brief Add this instance's parsed tree to the file cache
+	void AddToCache(const char* filename);
+
 	/// Disable copy
 	Xml(const Xml&) { }
 
@@ -0,0 +1,297 @@
+//! \file XmlTree.cxx
+//! \author G. Christian
+//! \brief Implements XmlTree.hxx
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include "XmlTree.hxx"
+
+
+namespace {
+
+/// Replace entities in place, as mxml_decode() does
+void decode(char* str)
+{
+	static const struct { const char* entity; size_t length; char c; } entities[] = {
+		{ "&lt;", 4, '<' }, { "&gt;", 4, '>' }, { "&amp;", 5, '&' }, { "&quot;", 6, '\"' }, { "&apos;", 6, '\'' }
+	};
+	const size_t nEntities = sizeof(entities) / sizeof(entities[0]);
+
+	char* in = strchr(str, '&');
+	if(!in) return;
+	char* out = in;
+	while(*in) {
+		size_t i = nEntities;
+		if(*in == '&') {
+			for(i = 0; i< nEntities; ++i)
+				if(!strncmp(in, entities[i].entity, entities[i].length)) break;
+		}
+		if(i < nEntities) {
+			*out++ = entities[i].c;
+			in += entities[i].length;
+		}
+		else *out++ = *in++;
+	}
+	*out = 0;
+}
+
+/// Check for white space, as isspace() in the "C" locale
+inline bool is_space(char c)
+{ return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+/// Skip white space, counting lines
+inline char* skip_space(char* p, int& line)
+{
+	while(is_space(*p)) {
+		if(*p == '\n') ++line;
+		++p;
+	}
+	return p;
+}
+
+/// Check if a character ends a tag name
+inline bool is_name_end(char c)
+{ return !c || is_space(c) || c == '/' || c == '>' || c == '<'; }
+
+/// Copy of an unterminated tag name
+std::string tag_name(const char* tag)
+{
+	const char* end = tag;
+	while(!is_name_end(*end)) ++end;
+	return std::string(tag, end);
+}
+
+/// Check if an unterminated tag name in the text is \e name (of length \e length)
+inline bool same_name(const char* tag, const char* name, size_t length)
+{
+	return !strncmp(tag, name, length) && is_name_end(tag[length]);
+}
+
+} // namespace
+
+
+// ====================== Class midas::XmlTree ====================== //
+
+midas::XmlTree::XmlTree()
+{ }
+
+midas::XmlNode* midas::XmlTree::AddNode(XmlNode* parent, XmlNode*& last, const char* name, int line)
+{
+	/*! \e last is the last child of \e parent so far, and is set to the new node. */
+	fNodes.push_back(XmlNode());
+	XmlNode* node = &fNodes.back();
+	node->name = name;
+	node->line_number = line;
+	node->parent = parent;
+	if(parent) {
+		if(last) last->next = node;
+		else parent->child = node;
+		++parent->n_children;
+	}
+	last = node;
+	return node;
+}
+
+bool midas::XmlTree::Fail(char* error, int error_size, int* error_line, int line, const char* message, const char* arg)
+{
+	if(error) {
+		char msg[256];
+		snprintf(msg, sizeof(msg), message, arg);
+		snprintf(error, error_size, "XML read error, line %d: %s", line, msg);
+	}
+	if(error_line) *error_line = line;
+	fText.clear();
+	fNodes.clear();
+	fAttributes.clear();
+	return false;
+}
+
+bool midas::XmlTree::Parse(const char* text, size_t length, char* error, int error_size, int* error_line)
+{
+	/*!
+	 * Reading stops at the first NUL character in \e text, if any. Elements
+	 * left open at the end of the text are kept, as mxml_parse_buffer() does.
+	 */
+	if(error) error[0] = 0;
+	fText.assign(text, text + length);
+	fText.push_back(0);
+
+	// Every element has a '<' and every attribute an '=': with room for that
+	// many, the arrays are never reallocated, and node pointers stay valid
+	fNodes.clear();
+	fAttributes.clear();
+	size_t nTags = 0, nEquals = 0;
+	for(std::vector<char>::const_iterator c = fText.begin(); c != fText.end(); ++c) {
+		nTags += (*c == '<');
+		nEquals += (*c == '=');
+	}
+	fNodes.reserve(nTags + 1);
+	fAttributes.reserve(2*nEquals);
+
+	// Strings found (start and end), terminated once the parse is done: until
+	// then, the characters after them are still needed
+	std::vector<std::pair<char*, char*> > strings;
+	strings.reserve(fNodes.capacity() + fAttributes.capacity());
+	// Last child of each open element
+	std::vector<XmlNode*> last(1, (XmlNode*)0);
+
+	XmlNode* none = 0;
+	XmlNode* root = AddNode(0, none, "root", 0);
+	XmlNode* tree = root;
+	int line = 1;
+	char* p = &fText[0];
+
+	do {
+		if(*p == '<') {
+			p = skip_space(p + 1, line);
+			if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+
+			if(!strncmp(p, "!--", 3)) { // comment
+				char* end = strstr(p + 3, "-->");
+				if(!end) return Fail(error, error_size, error_line, line, "Unterminated comment");
+				line += std::count(p, end, '\n');
+				p = end + 3;
+			}
+			else if(*p == '?') { // processing instruction
+				char* end = strstr(p + 1, "?>");
+				if(!end) return Fail(error, error_size, error_line, line, "Unterminated ?...? element");
+				line += std::count(p, end, '\n');
+				p = end + 2;
+			}
+			else if(!strncmp(p, "!DOCTYPE", 8)) {
+				p += 8;
+				if(!strchr(p, '>')) return Fail(error, error_size, error_line, line, "Unterminated !DOCTYPE element");
+				for(int depth = 0; *p && (*p != '>' || depth > 0); ++p) {
+					if(*p == '\n') ++line;
+					else if(*p == '<') ++depth;
+					else if(*p == '>') --depth;
+				}
+				if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+				++p;
+			}
+			else { // element
+				const bool endElement = (*p == '/');
+				if(endElement) {
+					p = skip_space(p + 1, line);
+					if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+				}
+
+				char* name = p;
+				while(*p && !is_space(*p) && *p != '/' && *p != '>' && *p != '<') ++p;
+				if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+				if(*p == '<') return Fail(error, error_size, error_line, line, "Unexpected \'<\' inside element \"%s\"", std::string(name, p).c_str());
+
+				if(endElement) {
+					if(tree == root)
+						return Fail(error, error_size, error_line, line, "Found unexpected </%s>", std::string(name, p).c_str());
+					if(!same_name(tree->name, name, p - name)) {
+						const std::string found = "Found </" + std::string(name, p) + ">, expected </" + tag_name(tree->name) + ">";
+						return Fail(error, error_size, error_line, line, "%s", found.c_str());
+					}
+					tree = tree->parent;
+					last.pop_back();
+				}
+				else {
+					strings.push_back(std::make_pair(name, p));
+					XmlNode* node = AddNode(tree, last.back(), name, line);
+
+					p = skip_space(p, line);
+					if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+					while(*p != '>' && *p != '/') { // attributes
+						char* attribute = p;
+						while(*p && !is_space(*p) && *p != '=' && *p != '<' && *p != '>') ++p;
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						if(*p == '<' || *p == '>')
+							return Fail(error, error_size, error_line, line, "Unexpected \'<\' or \'>\' inside element \"%s\"", tag_name(name).c_str());
+						strings.push_back(std::make_pair(attribute, p));
+
+						p = skip_space(p, line);
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						if(*p != '=') return Fail(error, error_size, error_line, line, "Expect \"=\" here");
+						p = skip_space(p + 1, line);
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						if(*p != '\"' && *p != '\'') return Fail(error, error_size, error_line, line, "Expect \" or \' here");
+
+						const char quote = *p++;
+						char* value = p;
+						while(*p && *p != quote) {
+							if(*p == '\n') ++line;
+							++p;
+						}
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						strings.push_back(std::make_pair(value, p));
+						fAttributes.push_back(attribute);
+						fAttributes.push_back(value);
+						++node->n_attributes;
+
+						p = skip_space(p + 1, line);
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+					}
+
+					if(*p == '/') { // empty element, <tag/>
+						p = skip_space(p + 1, line);
+						if(!*p) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						if(*p != '>') return Fail(error, error_size, error_line, line, "Expected \">\" after \"/\"");
+						++p;
+					}
+					else {
+						char* value = ++p;
+						char* pv = skip_space(p, line);
+						if(!*pv) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+						if(*pv != '<' || pv[1] == '/') { // value, rather than child elements
+							while(*pv && *pv != '<') {
+								if(*pv == '\n') ++line;
+								++pv;
+							}
+							if(!*pv) return Fail(error, error_size, error_line, line, "Unexpected end of file");
+							node->value = value;
+							strings.push_back(std::make_pair(value, pv));
+						}
+						p = pv;
+						tree = node;
+						last.push_back(0);
+					}
+				}
+			}
+		}
+
+		// go to the next tag
+		while(*p && *p != '<') {
+			if(*p == '\n') ++line;
+			++p;
+		}
+	} while(*p);
+
+	for(size_t i=0; i< strings.size(); ++i) {
+		*strings[i].second = 0;
+		decode(strings[i].first);
+	}
+
+	// Attributes were added node by node, in document order
+	const char** attribute = fAttributes.empty() ? 0 : &fAttributes[0];
+	for(size_t i=0; i< fNodes.size(); ++i) {
+		fNodes[i].attributes = attribute;
+		attribute += 2*fNodes[i].n_attributes;
+	}
+
+	return true;
+}
+
+midas::XmlNode* midas::XmlTree::FindChild(XmlNode* node, const char* name)
+{
+	for(XmlNode* child = node ? node->child : 0; child; child = child->next)
+		if(!strcmp(child->name, name)) return child;
+	return 0;
+}
+
+midas::XmlNode* midas::XmlTree::FindChild(XmlNode* node, const char* name, const char* nameAttribute)
+{
+	for(XmlNode* child = node ? node->child : 0; child; child = child->next) {
+		if(strcmp(child->name, name)) continue;
+		const char* attribute = child->GetAttribute("name");
+		if(attribute && !strcmp(attribute, nameAttribute)) return child;
+	}
+	return 0;
+}
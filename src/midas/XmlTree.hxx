@@ -0,0 +1,110 @@
+//! \file XmlTree.hxx
+//! \author G. Christian
+//! \brief Defines an in-place parser for ODB XML data.
+#ifndef MIDAS_XML_TREE_HXX
+#define MIDAS_XML_TREE_HXX
+#include <cstring>
+#include <vector>
+
+
+namespace midas {
+
+/// Element of an XML tree parsed by midas::XmlTree
+/*!
+ * All strings point into the text held by the tree they belong to, and all
+ * nodes and attributes are stored in the tree's arrays: nothing is allocated
+ * per node.
+ */
+struct XmlNode {
+	/// Tag name
+	const char* name;
+	/// Text between the start tag and the first child or end tag (NULL for empty elements, `<tag/>`)
+	const char* value;
+	/// Number of attributes
+	int n_attributes;
+	/// Attribute names and values, in pairs
+	const char** attributes;
+	/// Line of the start tag, starting from 1
+	int line_number;
+	/// Enclosing element (NULL for the document node)
+	XmlNode* parent;
+	/// First child element (NULL if none)
+	XmlNode* child;
+	/// Next sibling element (NULL for the last one)
+	XmlNode* next;
+	/// Number of child elements
+	int n_children;
+
+	/// Value of an attribute, NULL if the element has none by that name
+	const char* GetAttribute(const char* attribute) const
+		{
+			for(int i=0; i< n_attributes; ++i)
+				if(!strcmp(attributes[2*i], attribute)) return attributes[2*i + 1];
+			return 0;
+		}
+};
+
+/// XML tree parsed in place, without copying strings
+/*!
+ * Parse() takes one copy of the XML text, then tokenizes that copy in place:
+ * names, attributes and values are terminated (and entities such as `&amp;`
+ * decoded) where they stand, and nodes and attributes are stored in two
+ * arrays sized once from the text. The number of allocations made by a parse
+ * does not depend on the size of the ODB.
+ *
+ * Elements are read as mxml_parse_buffer() reads them, but comments,
+ * processing instructions and DOCTYPE declarations are skipped rather than
+ * stored.
+ */
+class XmlTree {
+public:
+	/// Empty tree
+	XmlTree();
+
+	/// \brief Parse XML text
+	/// \param [in] text XML text (need not be NUL-terminated)
+	/// \param [in] length Length of \e text
+	/// \param [out] error Error message, if any
+	/// \param [in] error_size Size of \e error
+	/// \param [out] error_line Line of the error, if any
+	/// \returns true if the text was parsed, false (and the tree is empty) otherwise
+	bool Parse(const char* text, size_t length, char* error, int error_size, int* error_line);
+
+	/// Document node, parent of the top-level elements (NULL if nothing was parsed)
+	XmlNode* GetRoot() { return fNodes.empty() ? 0 : &fNodes[0]; }
+
+	/// First child of \e node with a given tag name (NULL if none)
+	static XmlNode* FindChild(XmlNode* node, const char* name);
+
+	/// First child of \e node with a given tag name and "name" attribute (NULL if none)
+	static XmlNode* FindChild(XmlNode* node, const char* name, const char* nameAttribute);
+
+	/// Number of elements (including the document node)
+	size_t Size() const { return fNodes.size(); }
+
+private:
+	/// Add an element as the last child of \e parent
+	XmlNode* AddNode(XmlNode* parent, XmlNode*& last, const char* name, int line);
+
+	/// Report a parse error and empty the tree
+	bool Fail(char* error, int error_size, int* error_line, int line, const char* message, const char* arg = "");
+
+	/// Disable copy (nodes point into the tree's own arrays)
+	XmlTree(const XmlTree&) { }
+
+	/// Disable assign
+	XmlTree& operator= (const XmlTree&) { return *this; }
+
+private:
+	/// Copy of the parsed text, holding all strings
+	std::vector<char> fText;
+	/// All nodes, the document node first
+	std::vector<XmlNode> fNodes;
+	/// Attribute names and values of all nodes
+	std::vector<const char*> fAttributes;
+};
+
+} // namespace midas
+
+
+#endif
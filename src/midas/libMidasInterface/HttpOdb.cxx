@@ -9,19 +9,52 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include <iostream>
+#include <sstream>
 #include <assert.h>
 
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
 #include "HttpOdb.h"
 
+// Separator of the values in replies to multi-path ("odb0=...&odb1=...") requests
+static const char kMultiSeparator[] = "$#----#$\n";
+
+// Longest query sent in one request (longer multi-path requests are split)
+static const size_t kMaxQuery = 4000;
+
 HttpOdb::HttpOdb(const char* url) //ctor
 {
   fDebug = 0;
   fUrl = strdup(url);
+  fSocket = -1;
+  fCacheEnabled = true;
+  fNumConnections = 0;
+  fNumRequests = 0;
+
+  // split "http://host:port/file?options"
+  std::string s = url;
+  if (s.compare(0, 7, "http://") == 0)
+    s = s.substr(7);
+  size_t slash = s.find('/');
+  std::string hostport = s.substr(0, slash);
+  if (slash != std::string::npos)
+    fFile = s.substr(slash + 1);
+  size_t colon = hostport.find(':');
+  fHost = hostport.substr(0, colon);
+  fPort = (colon != std::string::npos) ? hostport.substr(colon + 1) : "80";
 }
 
 HttpOdb::~HttpOdb() // dtor
 {
+  disconnectServer();
   if (fUrl)
     free((void*)fUrl);
   fUrl = NULL;
@@ -29,124 +62,364 @@ HttpOdb::~HttpOdb() // dtor
 
 // GET /CS/F000.html?cmd=jset&odb=/equipment/mscb/settings/FGD/Feb_demand/power[0]&value=y HTTP/1.1
 
-#include "TUrl.h"
-#include "TSocket.h"
+static std::string urlEncode(const std::string& s)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  std::string out;
+  for (size_t i=0; i<s.size(); i++)
+    {
+      unsigned char c = s[i];
+      if (isalnum(c) || strchr("/[]-_.~*", c))
+        out += c;
+      else
+        {
+          out += '%';
+          out += hex[c >> 4];
+          out += hex[c & 0xF];
+        }
+    }
+  return out;
+}
 
-const char* HttpOdb::jget(const char* path, int index)
+// Check a single value returned by mhttpd, NULL if it is an error
+static const char* checkValue(const char* p)
 {
-  // index "-1" is special for "return whole array"
-  if (index < 0)
+  if (strcmp(p, "<DB_NO_KEY>") == 0)
     return NULL;
 
-  TUrl xurl(fUrl);
-
-  TSocket s(xurl.GetHost(), xurl.GetPort());
+  if (strcmp(p, "<DB_OUT_OF_RANGE>") == 0)
+    return NULL;
 
-  //char *req = "GET /CS/F000.html?cmd=jset&odb=/equipment/mscb/settings/FGD/Feb_demand/power[0]&value=y HTTP/1.1\r\n\r\n";
-  //char *req = "GET /CS/F000.html?cmd=jget&odb=/runinfo/run number HTTP/1.1\r\n\r\n";
+  if (strcmp(p, "<unknown>") == 0)
+    return NULL;
 
-  sprintf(fRequestBuf,"GET /%s?cmd=jget&odb=%s[%d] HTTP/1.1\r\n\r\n", xurl.GetFileAndOptions(), path, index);
+  if (strstr(p, "<html>") != NULL)
+    {
+      fprintf(stderr, "HttpOdb::jget: Bad mhttpd response: %s\n", p);
+      return NULL;
+    }
 
-  if (fDebug)
-    printf("Sending [%s]\n", fRequestBuf);
+  return p;
+}
 
-  s.SendRaw(fRequestBuf, strlen(fRequestBuf));
-  int rd = s.RecvRaw(fReplyBuf, sizeof(fReplyBuf));
+bool HttpOdb::connectServer()
+{
+  struct addrinfo hints, *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
 
-  if (fDebug)
-    printf("Received %d [%s]\n", rd, fReplyBuf);
+  int status = getaddrinfo(fHost.c_str(), fPort.c_str(), &hints, &res);
+  if (status != 0)
+    {
+      fprintf(stderr, "HttpOdb: Cannot resolve \"%s:%s\": %s\n", fHost.c_str(), fPort.c_str(), gai_strerror(status));
+      return false;
+    }
 
-  if (rd < 10)
-    return NULL;
+  for (struct addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+      fSocket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fSocket < 0)
+        continue;
+      if (connect(fSocket, ai->ai_addr, ai->ai_addrlen) == 0)
+        break;
+      close(fSocket);
+      fSocket = -1;
+    }
+  freeaddrinfo(res);
 
-  if (strstr(fReplyBuf, "200 Document follows") == NULL)
-    return NULL;
+  if (fSocket < 0)
+    {
+      fprintf(stderr, "HttpOdb: Cannot connect to \"%s:%s\"\n", fHost.c_str(), fPort.c_str());
+      return false;
+    }
 
-  fReplyBuf[rd] = 0;
+  // small requests & replies: do not wait to fill packets
+  int one = 1;
+  setsockopt(fSocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+  setsockopt(fSocket, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
 
-  const char* p = strstr(fReplyBuf,"\r\n\r\n");
-  if (!p)
-    return NULL;
+  // do not hang forever on a busy mhttpd
+  struct timeval tv;
+  tv.tv_sec = 30;
+  tv.tv_usec = 0;
+  setsockopt(fSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
 
-  p += 4;
+  fNumConnections++;
+  return true;
+}
 
-  if (strcmp(p, "<DB_NO_KEY>") == 0)
-    return NULL;
+void HttpOdb::disconnectServer()
+{
+  if (fSocket >= 0)
+    close(fSocket);
+  fSocket = -1;
+}
 
-  if (strcmp(p, "<DB_OUT_OF_RANGE>") == 0)
-    return NULL;
+bool HttpOdb::exchange(const std::string& req, std::string& body, int& status)
+{
+  status = 0;
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  flags = MSG_NOSIGNAL;
+#endif
 
-  if (strcmp(p, "<unknown>") == 0)
-    return NULL;
+  for (size_t sent = 0; sent < req.size(); )
+    {
+      ssize_t wr = send(fSocket, req.data() + sent, req.size() - sent, flags);
+      if (wr <= 0)
+        return false;
+      sent += wr;
+    }
+  fNumRequests++;
 
-  if (strstr(p, "<html>") != NULL)
+  // read the status line and headers
+  std::string reply;
+  size_t hend = std::string::npos;
+  char buf[4096];
+  while (hend == std::string::npos)
     {
-      fprintf(stderr, "HttpOdb::jget: Bad mhttpd response: %s\n", p);
-      return NULL;
+      ssize_t rd = recv(fSocket, buf, sizeof(buf), 0);
+      if (rd <= 0)
+        return false;
+      reply.append(buf, rd);
+      hend = reply.find("\r\n\r\n");
     }
 
+  std::string head = reply.substr(0, hend);
+  body = reply.substr(hend + 4);
+
   if (fDebug)
-    printf("----> mhttpd %s[%d] return [%s]\n", path, index, p);
-  
-  return p;
-}
+    printf("Received [%s]\n", head.c_str());
 
-const char* HttpOdb::jkey(const char* path)
-{
-  TUrl xurl(fUrl);
+  if (head.compare(0, 5, "HTTP/") != 0)
+    return false;
+
+  size_t sp = head.find(' ');
+  if (sp != std::string::npos)
+    status = atoi(head.c_str() + sp + 1);
+
+  // find the reply length and whether the server keeps the connection
+  long length = -1;
+  bool keepAlive = (head.compare(0, 8, "HTTP/1.1") == 0);
+  std::istringstream headers(head);
+  std::string line;
+  while (std::getline(headers, line))
+    {
+      if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0)
+        length = atol(line.c_str() + 15);
+      else if (strncasecmp(line.c_str(), "Connection:", 11) == 0)
+        keepAlive = (strcasestr(line.c_str() + 11, "close") == NULL);
+    }
+
+  // read the body: up to its length, or to the end of the connection
+  while (length < 0 || (long)body.size() < length)
+    {
+      ssize_t rd = recv(fSocket, buf, sizeof(buf), 0);
+      if (rd < 0)
+        return false;
+      if (rd == 0)
+        {
+          if (length >= 0)
+            return false; // truncated
+          keepAlive = false;
+          break;
+        }
+      body.append(buf, rd);
+    }
+  if (length >= 0)
+    body.resize(length);
 
-  TSocket s(xurl.GetHost(), xurl.GetPort());
+  if (!keepAlive)
+    disconnectServer();
 
-  //char *req = "GET /CS/F000.html?cmd=jset&odb=/equipment/mscb/settings/FGD/Feb_demand/power[0]&value=y HTTP/1.1\r\n\r\n";
-  //char *req = "GET /CS/F000.html?cmd=jget&odb=/runinfo/run number HTTP/1.1\r\n\r\n";
+  return true;
+}
 
-  sprintf(fRequestBuf,"GET /%s?cmd=jkey&odb=%s HTTP/1.1\r\n\r\n", xurl.GetFileAndOptions(), path);
+bool HttpOdb::request(const std::string& query, std::string& body)
+{
+  std::string req = "GET /" + fFile + (fFile.find('?') == std::string::npos ? "?" : "&") + query + " HTTP/1.1\r\n";
+  req += "Host: " + fHost + ":" + fPort + "\r\n";
+  req += "Connection: keep-alive\r\n\r\n";
 
   if (fDebug)
-    printf("Sending [%s]\n", fRequestBuf);
+    printf("Sending [%s]\n", req.c_str());
 
-  s.SendRaw(fRequestBuf, strlen(fRequestBuf));
-  int rd = s.RecvRaw(fReplyBuf, sizeof(fReplyBuf));
+  // a kept-alive connection may have been closed by the server since the last request: retry once
+  for (int attempt = 0; attempt < 2; attempt++)
+    {
+      bool reused = (fSocket >= 0);
+      if (!reused && !connectServer())
+        return false;
+      int status;
+      if (exchange(req, body, status))
+        {
+          if (status == 200)
+            return true;
+          // an answer, but not a value: not worth retrying
+          fprintf(stderr, "HttpOdb: Request to \"%s:%s\" failed with HTTP status %d\n", fHost.c_str(), fPort.c_str(), status);
+          body.clear();
+          return false;
+        }
+      disconnectServer();
+      if (!reused)
+        break;
+    }
 
-  if (fDebug)
-    printf("Received %d [%s]\n", rd, fReplyBuf);
+  fprintf(stderr, "HttpOdb: Request to \"%s:%s\" failed\n", fHost.c_str(), fPort.c_str());
+  return false;
+}
 
-  if (rd < 10)
-    return NULL;
+bool HttpOdb::jgetMany(const std::vector<std::string>& items, std::vector<std::string>& replies)
+{
+  replies.clear();
+  size_t first = 0;
+  while (first < items.size())
+    {
+      // as many paths as fit in one request
+      std::string query = "cmd=jget";
+      size_t last = first;
+      for (; last < items.size(); last++)
+        {
+          std::ostringstream param;
+          param << "&odb" << (last - first) << "=" << urlEncode(items[last]);
+          if (last > first && query.size() + param.str().size() > kMaxQuery)
+            break;
+          query += param.str();
+        }
+
+      std::string body;
+      if (!request(query, body))
+        return false;
+
+      size_t pos = 0;
+      for (size_t i = first; i < last; i++)
+        {
+          size_t end = body.find(kMultiSeparator, pos);
+          if ((end == std::string::npos) != (i + 1 == last))
+            {
+              fprintf(stderr, "HttpOdb::jgetMany: Bad mhttpd response: %s\n", body.c_str());
+              return false;
+            }
+          replies.push_back(body.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+          pos = end + strlen(kMultiSeparator);
+        }
+      first = last;
+    }
+  return true;
+}
 
-  if (strstr(fReplyBuf, "200 Document follows") == NULL)
+const char* HttpOdb::jget(const char* path, int index)
+{
+  // index "-1" is special for "return whole array"
+  if (index < 0)
     return NULL;
 
-  fReplyBuf[rd] = 0;
+  std::ostringstream item;
+  item << path << "[" << index << "]";
 
-  const char* p = strstr(fReplyBuf,"\r\n\r\n");
-  if (!p)
+  if (fCacheEnabled)
+    {
+      std::map<std::string, std::string>::const_iterator it = fCache.find(item.str());
+      if (it == fCache.end() && index < odbReadArraySize(path))
+        {
+          // fetch the whole array at once, then look again
+          std::vector<std::string> names(1, path);
+          odbPrefetch(names);
+          it = fCache.find(item.str());
+        }
+      if (it == fCache.end())
+        return NULL;
+      if (fDebug)
+        printf("----> mhttpd %s return [%s]\n", item.str().c_str(), it->second.c_str());
+      return it->second.c_str();
+    }
+
+  std::vector<std::string> items(1, item.str()), replies;
+  if (!jgetMany(items, replies))
     return NULL;
 
-  p += 4;
+  fReply = replies[0];
+  if (fDebug)
+    printf("----> mhttpd %s return [%s]\n", item.str().c_str(), fReply.c_str());
 
-  if (strcmp(p, "<DB_NO_KEY>") == 0)
-    return NULL;
+  return checkValue(fReply.c_str());
+}
 
-  if (strcmp(p, "<DB_OUT_OF_RANGE>") == 0)
+const char* HttpOdb::jkey(const char* path)
+{
+  if (fCacheEnabled)
+    {
+      std::map<std::string, std::string>::const_iterator it = fKeys.find(path);
+      if (it != fKeys.end())
+        return it->second.c_str();
+    }
+
+  std::string body;
+  if (!request(std::string("cmd=jkey&odb=") + urlEncode(path), body))
     return NULL;
 
-  if (strcmp(p, "<unknown>") == 0)
+  if (fDebug)
+    printf("----> mhttpd %s return [%s]\n", path, body.c_str());
+
+  if (!checkValue(body.c_str()))
     return NULL;
 
-  if (strstr(p, "<html>") != NULL)
+  if (!fCacheEnabled)
     {
-      fprintf(stderr, "HttpOdb::jget: Bad mhttpd response: %s\n", p);
-      return NULL;
+      fReply = body;
+      return fReply.c_str();
     }
 
-  if (fDebug)
-    printf("----> mhttpd %s return [%s]\n", path, p);
-  
-  return p;
+  return fKeys[path].assign(body).c_str();
+}
+
+int HttpOdb::odbPrefetch(const std::vector<std::string>& names)
+{
+  std::vector<std::string> items;
+  for (size_t i=0; i<names.size(); i++)
+    {
+      int size = odbReadArraySize(names[i].c_str());
+      for (int j=0; j<size; j++)
+        {
+          std::ostringstream item;
+          item << names[i] << "[" << j << "]";
+          items.push_back(item.str());
+        }
+    }
+
+  std::vector<std::string> replies;
+  if (!jgetMany(items, replies))
+    return 0;
+
+  int n = 0;
+  for (size_t i=0; i<items.size(); i++)
+    {
+      if (!checkValue(replies[i].c_str()))
+        continue;
+      if (fCacheEnabled)
+        fCache[items[i]] = replies[i];
+      n++;
+    }
+  return n;
+}
+
+void HttpOdb::odbInvalidate()
+{
+  fCache.clear();
+  fKeys.clear();
+}
+
+void HttpOdb::SetCache(bool enable)
+{
+  fCacheEnabled = enable;
+  if (!enable)
+    odbInvalidate();
 }
 
-int      HttpOdb::odbReadAny(   const char*name, int index, int tid,void* buf, int bufsize)    { assert(!"Not implemented!"); }
+int      HttpOdb::odbReadAny(   const char*name, int index, int tid,void* buf, int bufsize)    { assert(!"Not implemented!"); return 0; }
 
 uint32_t HttpOdb::odbReadUint32(const char*name, int index, uint32_t defaultValue)
 {
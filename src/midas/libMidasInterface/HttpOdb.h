@@ -10,6 +10,9 @@
 #ifndef INCLUDE_HttpOdb_H
 #define INCLUDE_HttpOdb_H
 
+#include <map>
+#include <string>
+#include <vector>
 #include "VirtualOdb.h"
 
 ///
@@ -21,6 +24,13 @@
 ///
 /// In this usage, the string "secret.html" functions as an access password.
 ///
+/// All requests go through a single keep-alive connection, which is re-opened if the server closes it.
+///
+/// Values read are cached: reading any element of an array fetches the whole array in one request
+/// (several paths are sent at once as "odb0=...&odb1=..."), and odbPrefetch() does the same for a list
+/// of arrays. Cached values are not updated when the ODB changes: call odbInvalidate() at run
+/// transitions (or disable the cache with SetCache(false)).
+///
 
 /// Access to ODB through the MIDAS HTTP server mhttpd
 
@@ -46,13 +56,51 @@ class HttpOdb : public VirtualOdb
   const char* odbReadString(const char*name, int index, const char* defaultValue);
   int      odbReadArraySize(const char*name);
 
+  /// Fetch all values of several keys or arrays into the cache, returns the number of values fetched
+  int      odbPrefetch(const std::vector<std::string>& names);
+
+  /// Drop all cached values and array sizes
+  void     odbInvalidate();
+
+  /// Enable or disable the cache (enabled by default)
+  void     SetCache(bool enable);
+
+  /// Number of connections made to the server so far
+  int      GetNumConnections() const { return fNumConnections; }
+
+  /// Number of requests sent to the server so far
+  int      GetNumRequests() const { return fNumRequests; }
+
  protected:
   const char* jkey(const char* path);
   const char* jget(const char* path, int index);
 
+  /// Read several "path[index]" values in as few requests as possible, false if any request failed
+  bool jgetMany(const std::vector<std::string>& items, std::vector<std::string>& replies);
+
+  /// Send a request over the persistent connection and read the reply body, false on error or a status other than 200
+  bool request(const std::string& query, std::string& body);
+
+  /// Send a request and read the reply and its HTTP status, once, over the present connection
+  bool exchange(const std::string& request, std::string& body, int& status);
+
+  /// Open the connection to the server
+  bool connectServer();
+
+  /// Close the connection to the server
+  void disconnectServer();
+
  protected:
-  char fRequestBuf[1024];
-  char fReplyBuf[1024];
+  std::string fHost;      ///< Server host name
+  std::string fPort;      ///< Server port
+  std::string fFile;      ///< Path and options of the URL, without the leading '/'
+  int fSocket;            ///< Connection to the server, -1 if not connected
+  bool fCacheEnabled;     ///< Is the cache enabled
+  std::map<std::string, std::string> fCache; ///< Cached values, by "path[index]"
+  std::map<std::string, std::string> fKeys;  ///< Cached jkey replies, by path
+  std::string fReply;     ///< Last value read when the cache is disabled
+  int fNumConnections;    ///< Connections made
+  int fNumRequests;       ///< Requests sent
 };
 
 #endif
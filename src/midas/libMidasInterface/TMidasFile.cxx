@@ -338,6 +338,90 @@ bool TMidasFile::Read(TMidasEvent *midasEvent)
   return true;
 }
 
+int TMidasFile::ReadSome(char* buf, int length)
+{
+  /// Read up to \e length bytes, stopping early at the current end of the file
+  /// \returns The number of bytes read, -1 for error
+
+  if (fGzFile)
+    {
+#ifdef HAVE_ZLIB
+      int rd = gzread(*(gzFile*)fGzFile, buf, length);
+      if (rd < length)
+        gzclearerr(*(gzFile*)fGzFile); // so the next gzread() continues where this one stopped
+      return rd;
+#else
+      assert(!"Cannot get here");
+#endif
+    }
+  return readpipe(fFile, buf, length);
+}
+
+int TMidasFile::ReadFollow(TMidasEvent *midasEvent)
+{
+  /// Read one event from a file that is still being written, e.g. by the
+  /// MIDAS logger. Unlike Read(), reaching the end of the file in the middle
+  /// of an event is not an error: the part read so far is kept, and the
+  /// rest is read by the next call, once it has been written.
+  ///
+  /// \param [in] midasEvent Pointer to an empty TMidasEvent
+  /// \returns 1 if an event was read, 0 if no complete event is available
+  ///  yet (try again later), -1 for error, see GetLastError() to see why
+
+  midasEvent->Clear();
+
+  const int headerSize = sizeof(TMidas_EVENT_HEADER);
+  int eventSize = 0; // not known until the header is complete
+  bool atEnd = false;
+
+  for (;;)
+    {
+      if (!eventSize && (int)fPartial.size() >= headerSize)
+        {
+          memcpy(midasEvent->GetEventHeader(), fPartial.data(), headerSize);
+          if (fDoByteSwap)
+            midasEvent->SwapBytesEventHeader();
+          if (!midasEvent->IsGoodSize())
+            {
+              fLastErrno = -1;
+              fLastError = "Invalid event size";
+              return -1;
+            }
+          eventSize = headerSize + midasEvent->GetDataSize();
+        }
+      if (eventSize && (int)fPartial.size() >= eventSize)
+        break;
+      if (atEnd)
+        {
+          fLastErrno = 0;
+          fLastError = "EOF";
+          return 0;
+        }
+
+      char buf[65536];
+      int want = (eventSize ? eventSize : headerSize) - fPartial.size();
+      if (want > (int)sizeof(buf))
+        want = sizeof(buf);
+
+      int rd = ReadSome(buf, want);
+      if (rd < 0)
+        {
+          fLastErrno = errno;
+          fLastError = strerror(errno);
+          return -1;
+        }
+      fPartial.append(buf, rd);
+      atEnd = (rd < want);
+    }
+
+  memcpy(midasEvent->GetData(), fPartial.data() + headerSize, midasEvent->GetDataSize());
+  fPartial.clear();
+
+  midasEvent->SwapBytes(false);
+
+  return 1;
+}
+
 bool TMidasFile::Write(TMidasEvent *midasEvent)
 {
   int wr = -2;
@@ -385,6 +469,7 @@ void TMidasFile::Close()
     close(fFile);
   fFile = -1;
   fFilename = "";
+  fPartial.clear();
 }
 
 void TMidasFile::OutClose()
@@ -24,6 +24,7 @@ public:
   void OutClose(); ///< Close output file
 
   bool Read(TMidasEvent *event); ///< Read one event from the file
+  int ReadFollow(TMidasEvent *event); ///< Read one event from a file that is still being written
   bool Write(TMidasEvent *event); ///< Write one event to the output file
 
   const char* GetFilename()  const { return fFilename.c_str();  } ///< Get the name of this file
@@ -32,6 +33,8 @@ public:
 
 protected:
 
+  int ReadSome(char* buf, int length); ///< Read what is available, up to length bytes
+
   std::string fFilename; ///< name of the currently open file
   std::string fOutFilename; ///< name of the currently open file
 
@@ -40,6 +43,8 @@ protected:
 
   bool fDoByteSwap; ///< "true" if file has to be byteswapped
 
+  std::string fPartial; ///< start of an event not yet completely written, see ReadFollow()
+
   int         fFile; ///< open input file descriptor
   void*       fGzFile; ///< zlib compressed input file reader
   void*       fPoFile; ///< popen() input file reader
@@ -450,16 +450,28 @@ void rootana::App::run_start(int runnum)
 	rootana::gTailScaler.reset();
 	rootana::gDiagnostics.reset();
 
-	/// Read variables from the ODB
-	rootana::gHead.set_variables("online");
-	rootana::gTail.set_variables("online");
-	rootana::gCoinc.set_variables("online");
-	rootana::gHeadScaler.set_variables("online", "head");
-	rootana::gTailScaler.set_variables("online", "tail");
+	/// Read variables from the ODB, through a single copy of the directories they are in
+	{
+		midas::Database odb("online");
+		odb.Snapshot("/dragon");
+		odb.Snapshot("/Equipment");
+		rootana::gHead.set_variables(&odb);
+		rootana::gTail.set_variables(&odb);
+		rootana::gCoinc.set_variables(&odb);
+		rootana::gHeadScaler.set_variables(&odb, "head");
+		rootana::gTailScaler.set_variables(&odb, "tail");
+	}
 
 	bool opened = fOutputFile->Open(runnum, fHistos.c_str());
 	if(!opened) Terminate(1);
 
+	/// Only calculate the derived quantities used by the histograms
+	uint32_t derived = fOutputFile->GetDerived();
+	if(fOnlineHists.get()) derived |= fOnlineHists->GetDerived();
+	rootana::gHead.set_derived(derived);
+	rootana::gTail.set_derived(derived);
+	rootana::gCoinc.set_derived(derived);
+
 	dragon::utils::Info("rootana") << "Start of run " << runnum;
 }
 
@@ -38,10 +38,11 @@ void rootana::Directory::DeleteHists()
 		it->second.clear();
 	}
 	fHistos.clear();
+	fDerived = 0;
 }
 
 rootana::Directory::Directory(TDirectory* dir):
-	fDir(dir)
+	fDerived(0), fDir(dir)
 {
 	VerboseNetDirectoryServer(true);
 }
@@ -112,6 +113,7 @@ void rootana::Directory::CreateHists(const char* definitionFile)
 	rootana::HistParser parse (definitionFile);
 	parse.Run();
 	parse.Transfer(this);
+	fDerived |= parse.GetDerived();
 }
 
 TDirectory* rootana::Directory::CreateSubDirectory(const char* path)
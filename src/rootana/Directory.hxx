@@ -38,6 +38,9 @@ private:
 	/*! See Map_t typedef */
 	Map_t fHistos;
 
+	/// Derived quantities referenced by the histograms (dragon::derived::Quantity_t)
+	uint32_t fDerived;
+
 	/// Internal ROOT directory
 	/*!
 	 * \note Derived classes may set this to a specific type using the Reset() method.
@@ -62,6 +65,8 @@ public:
 	bool IsOpen() const;
 	/// Resets fDir to a new directory, calling the destructor on the old one.
 	void Reset (TDirectory* newDir) { fDir.reset(newDir); }
+	/// Mask of derived quantities needed to fill the histograms
+	uint32_t GetDerived() const { return fDerived; }
 	/// Adds a histogram to \c this directory
 	void AddHist(rootana::HistBase* hist, const char* path, uint16_t eventId);
 	/// Virtual method to open (initialize) the directory
@@ -9,6 +9,7 @@
 #include "midas.h"
 #include "utils/definitions.h"
 #include "utils/ErrorDragon.hxx"
+#include "Dragon.hxx"
 #include "Histos.hxx"
 #include "Directory.hxx"
 #include "HistParser.hxx"
@@ -62,7 +63,7 @@ inline void throw_missing_arg(const char* which, int linenum, const char* fname)
 
 rootana::HistParser::HistParser(const char* filename):
 	fFilename(filename), fFile(filename),
-	fLine(""), fLineNumber(0), fDir("")
+	fLine(""), fLineNumber(0), fDir(""), fDerived(0)
 {
 	/*!
 	 *  \param filename Path to the histogram definition file
@@ -123,6 +124,7 @@ void rootana::HistParser::handle_command()
 		}
 		gROOT->ProcessLine(fLine.c_str(), &err);
 		if (err != 0) throw_bad_line(fLine, fLineNumber, fFilename);
+		fDerived |= dragon::derived::from_expression(fLine);
 	}
 	if (!done) throw_missing_arg("CMD:", fLineNumber, fFilename);
 
@@ -185,6 +187,7 @@ void rootana::HistParser::handle_hist(const char* type)
 		cmdParam[i] << "rootana::DataPointer::New(" << spar[i] << ");";
 		data[i] = (rootana::DataPointer*)gROOT->ProcessLineFast(cmdParam[i].str().c_str());
 		if (!data[i]) throw_bad_line (spar[i], lpar[i], fFilename);
+		fDerived |= dragon::derived::from_expression(spar[i]);
 	}
 
 	rootana::HistBase* h = 0;
@@ -236,6 +239,7 @@ void rootana::HistParser::handle_scaler()
 	cmdData << "rootana::DataPointer::New(" << spar << ");";
 	rootana::DataPointer* data = (rootana::DataPointer*)gROOT->ProcessLineFast(cmdData.str().c_str());
 	if (!data) throw_bad_line(spar, lpar, fFilename);
+	fDerived |= dragon::derived::from_expression(spar);
 
 	std::stringstream cmdHist;
 	cmdHist << "new TH1D" << shst << ";";
@@ -268,6 +272,7 @@ void rootana::HistParser::handle_summary()
 	cmdData << "rootana::DataPointer::New(" << spar << ", " << snum << ");";
 	rootana::DataPointer* data = (rootana::DataPointer*)gROOT->ProcessLineFast(cmdData.str().c_str());
 	if (!data) throw_bad_line(spar, lpar, fFilename);
+	fDerived |= dragon::derived::from_expression(spar);
 
 	std::stringstream cmdHist;
 	cmdHist << "new TH1D" << shst << ";";
@@ -294,6 +299,7 @@ void rootana::HistParser::handle_cut()
 	cmd << "( " << fLine << " ).get()->clone();";
 	rootana::Condition* condition = (rootana::Condition*)gROOT->ProcessLineFast(cmd.str().c_str());
 	if(!condition) throw_bad_line(fLine, fLineNumber, fFilename, &cmd);
+	fDerived |= dragon::derived::from_expression(fLine);
 
 	std::list<HistInfo>::iterator itEnd = fCreatedHistograms.end();
 	--itEnd;
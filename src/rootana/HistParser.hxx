@@ -45,6 +45,8 @@ private:
 	};
 	/// List of all histograms created by the parser (plus related info)
 	std::list<HistInfo> fCreatedHistograms;
+	/// Derived quantities referenced by the histograms and cuts (dragon::derived::Quantity_t)
+	uint32_t fDerived;
 
 public:
 	/// Sets fFile
@@ -55,6 +57,8 @@ public:
 	bool IsGood() { return fFile.good(); }
 	/// Runs through a file and creates histograms
 	void Run();
+	/// Mask of derived quantities referenced by the parsed histograms and cuts
+	uint32_t GetDerived() const { return fDerived; }
 	/// Transfers ownership of created histograms from \c this to a new class
 	template <class T> void Transfer(T* newOwner)
 		{
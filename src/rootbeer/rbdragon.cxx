@@ -121,6 +121,8 @@ void rbdragon::MidasBuffer::RunStartTransition(Int_t runnum)
     dragon::utils::Info("rbdragon::MidasBuffer")
       << "Syncing variable values with the online database.";
     midas::Database db("online");
+    db.Snapshot("/dragon");
+    db.Snapshot("/Equipment");
     ReadVariables(&db);
 
     // Also set auto zero level from "/dragon/rootbeer/AutoZero"
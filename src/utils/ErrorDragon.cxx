@@ -39,3 +39,73 @@ dutils::DelayedMessageFactory::~DelayedMessageFactory()
 {
 	std::for_each(fPrinters.begin(), fPrinters.end(), msgDelete());
 }
+
+
+// ================ Class dragon::utils::ErrorCounterTable ================ //
+
+dutils::ErrorCounterTable::ErrorCounterTable(const char* what, const char* location, const char* const* messages,
+																						 int ncodes, const char* file, int line):
+	fWhat(what), fLocation(location), fMessages(messages),
+	fNumCodes(ncodes < MAX_CODES ? ncodes : MAX_CODES), fFile(file), fLine(line)
+{
+	/*!
+	 * \param what Short error description, prefixed to every message
+	 * \param location Where the messages originate from
+	 * \param messages Array of `ncodes` message strings, must outlive the table
+	 * \param ncodes Number of distinct error codes (at most MAX_CODES)
+	 * \param file File from where the messages originate
+	 * \param line Line from where the messages originate
+	 */
+	Zero();
+}
+
+dutils::ErrorCounterTable::ErrorCounterTable(const ErrorCounterTable& other):
+	fWhat(other.fWhat), fLocation(other.fLocation), fMessages(other.fMessages),
+	fNumCodes(other.fNumCodes), fFile(other.fFile), fLine(other.fLine)
+{
+	///
+	Zero();
+}
+
+dutils::ErrorCounterTable& dutils::ErrorCounterTable::operator= (const ErrorCounterTable& other)
+{
+	///
+	fWhat     = other.fWhat;
+	fLocation = other.fLocation;
+	fMessages = other.fMessages;
+	fNumCodes = other.fNumCodes;
+	fFile     = other.fFile;
+	fLine     = other.fLine;
+	return *this;
+}
+
+void dutils::ErrorCounterTable::Zero()
+{
+	///
+	std::fill(fPrinters, fPrinters + MAX_CODES, (ADelayedMessagePrinter*)0);
+	std::fill(fTotal, fTotal + MAX_CODES, 0);
+}
+
+void dutils::ErrorCounterTable::ResetTotals()
+{
+	///
+	std::fill(fTotal, fTotal + MAX_CODES, 0);
+}
+
+dutils::ADelayedMessagePrinter* dutils::ErrorCounterTable::Register(int code, const char* bank, int32_t period)
+{
+	/*!
+	 * Printers are keyed by this table and the code, and are owned by
+	 * gDelayedMessageFactory, which prints them on Flush(). A printer keeps the
+	 * bank name in its message and the period it was registered with.
+	 */
+	ADelayedMessagePrinter* msg = gDelayedMessageFactory.Get(this, code);
+	if(!msg) {
+		std::stringstream temp;
+		temp << fWhat << " (bank \"" << (bank ? bank : "") << "\", addr " << this << "): " << fMessages[code];
+		msg = gDelayedMessageFactory.Register<Error>
+			(this, code, fLocation, period, fFile, fLine, temp.str().c_str());
+	}
+	fPrinters[code] = msg;
+	return msg;
+}
@@ -415,6 +415,76 @@ extern DelayedMessageFactory gDelayedMessageFactory;
 
 #endif // __MAKECINT__
 
+
+/// Fixed-size table of error counters for hot-path error accounting
+/*!
+ * Meant for module decoders that can see the same error many times per second.
+ * The message text is supplied once as a static array of C strings, and the
+ * message printer of each code is registered with gDelayedMessageFactory the
+ * first time that code occurs. From then on, recording an error increments a
+ * counter and the cached printer, so messages print on the same schedule as
+ * with DelayedMessageFactory::Get() and ADelayedMessagePrinter::Incr(), without
+ * any lookup or allocation.
+ *
+ * The table is owned by its module and never registered itself, so it can be
+ * created and destroyed at any time, including static initialization.
+ * Copies share the configuration (location, messages) but start from
+ * zero counts and their own printers, so copying a module never causes errors
+ * to be reported twice.
+ */
+class ErrorCounterTable {
+public:
+	/// Maximum number of distinct error codes
+	static const int MAX_CODES = 32;
+public:
+	/// Set up the table
+	ErrorCounterTable(const char* what, const char* location, const char* const* messages,
+										int ncodes, const char* file = "", int line = -1);
+	/// Copy configuration, zero counts
+	ErrorCounterTable(const ErrorCounterTable& other);
+	/// Copy configuration only, keeps existing counts and printers
+	ErrorCounterTable& operator= (const ErrorCounterTable& other);
+	/// Record one occurance of error `code`, from MIDAS bank `bank`
+	void Incr(int code, const char* bank, int32_t period)
+		{
+			++fTotal[code];
+			ADelayedMessagePrinter* msg = fPrinters[code] ? fPrinters[code] : Register(code, bank, period);
+			if(msg) msg->Incr();
+		}
+	/// Reset the cumulative (per-run) counts
+	void ResetTotals();
+	/// Cumulative number of occurances of error `code` since the last ResetTotals()
+	uint32_t GetTotal(int code) const
+		{ return code >= 0 && code < fNumCodes ? fTotal[code] : 0; }
+	/// Number of error codes in the table
+	int GetNumCodes() const { return fNumCodes; }
+	/// Static message text for error `code`
+	const char* GetMessage(int code) const
+		{ return code >= 0 && code < fNumCodes ? fMessages[code] : ""; }
+private:
+	/// Look up or register the message printer of `code`
+	ADelayedMessagePrinter* Register(int code, const char* bank, int32_t period);
+	/// Zero all counters and forget the printers
+	void Zero();
+private:
+	/// Error description (e.g. "TDC error")
+	const char* fWhat;
+	/// Where the messages originate from
+	const char* fLocation;
+	/// Static message text, indexed by code
+	const char* const* fMessages;
+	/// Number of distinct codes
+	int fNumCodes;
+	/// File from where the messages originate
+	const char* fFile;
+	/// Line from where the messages originate
+	int fLine;
+	/// Message printers, indexed by code (NULL until the code first occurs)
+	ADelayedMessagePrinter* fPrinters[MAX_CODES];
+	/// Cumulative counts
+	uint32_t fTotal[MAX_CODES];
+};
+
 } }  // namespace dragon namespace utils
 
 
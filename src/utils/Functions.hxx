@@ -8,6 +8,10 @@
 #include <functional>
 #include "Bits.hxx"
 #include "Valid.hxx"
+#include "VariableStructs.hxx"
+#if defined(__SSE2__) && !defined(__MAKECINT__)
+#include <emmintrin.h>
+#endif
 
 #ifndef __MAKECINT__
 #ifndef DOXYGEN_SKIP
@@ -233,6 +237,46 @@ inline void index_sort(T begin, T end, int* indices)
 	std::sort(indices, indices + size,	IsortLess<T> (begin));
 }
 
+/// Partial version of index_sort(): finds and sorts only the first `k` indices
+/*!
+ * On return, `indices[0 .. k)` hold the indices of the `k` first elements of
+ * [begin, end) in the order given by `order`; the remaining entries of `indices`
+ * are unspecified.
+ *
+ * For `k <= 4` the selection is done in a single pass, inserting each
+ * element into a short sorted list of the best `k` so far (elements comparing
+ * equal keep their original order). For larger `k` a partial sort of a short
+ * array is no cheaper than the full one, so this falls back to index_sort().
+ *
+ * \param [in] begin Beginning of the array whose sorted values you desire
+ * \param [in] end End of the array whose sorted values you desire
+ * \param [out] indices Pointer to the beginning of an array in which to store
+ * the sorted indices. <b>This array must contain space for every index.</b>
+ * \param [in] k Number of sorted indices desired
+ * \param [in] order instance of Order class for sorting.
+ */
+template <class T, class Order>
+inline void index_sort_k(T begin, T end, int* indices, int k, Order order)
+{
+	const int size = end - begin;
+	if(k > 4 || k >= size) {
+		index_sort(begin, end, indices, order);
+		return;
+	}
+	if(k > 0) {
+		int n = 0; // number of entries in the top-k list so far
+		for(int i=0; i< size; ++i) {
+			int j = n < k ? n++ : k;
+			if(j == k && !order(*(begin + i), *(begin + indices[k-1])))
+				continue;
+			if(j == k) --j;
+			for(; j > 0 && order(*(begin + i), *(begin + indices[j-1])); --j)
+				indices[j] = indices[j-1];
+			indices[j] = i;
+		}
+	}
+}
+
 /// Maps raw vme data into another array
 /*!
  * \tparam T Basic type of the output array
@@ -634,6 +678,171 @@ inline void polynomial_calibrate(int order, T& value, const V& variables)
 	}
 }
 
+#ifndef __MAKECINT__
+#ifndef DOXYGEN_SKIP
+/// Branch-free calibration kernels used by the fixed-size overloads below
+/*!
+ * Validity is handled with a mask (value != NoData) and a select instead of
+ * a per-element branch. The templates operate on elements [i, n) and are
+ * written so that the compiler can vectorize them; the `double` overloads
+ * use SSE2 directly where it is available and finish odd-length arrays with
+ * the template. The arithmetic is the same as in the generic array functions,
+ * so results are identical.
+ */
+namespace masked {
+template <class T>
+inline void pedestal_subtract(T* x, int i, int n, const int* pedestal)
+{
+	const T nd = NoData<T>::value();
+	for(; i< n; ++i)
+		x[i] = x[i] != nd ? x[i] - pedestal[i] : x[i];
+}
+template <class T, class T2>
+inline void zero_suppress1(T* x, int i, int n, const T2& threshold)
+{
+	const T nd = NoData<T>::value();
+	for(; i< n; ++i)
+		x[i] = x[i] != nd && x[i] < threshold ? 0 : x[i];
+}
+template <class T>
+inline void linear_calibrate(T* x, int i, int n, const double* offset, const double* slope)
+{
+	const T nd = NoData<T>::value();
+	for(; i< n; ++i)
+		x[i] = x[i] != nd ? offset[i] + x[i] * slope[i] : x[i];
+}
+template <class T>
+inline void quadratic_calibrate(T* x, int i, int n, const double* offset, const double* slope, const double* slope2)
+{
+	const T nd = NoData<T>::value();
+	for(; i< n; ++i)
+		x[i] = x[i] != nd ? offset[i] + x[i] * slope[i] + (x[i] * x[i]) * slope2[i] : x[i];
+}
+#ifdef __SSE2__
+inline __m128d select(__m128d mask, __m128d a, __m128d b)
+{
+	return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+inline void pedestal_subtract(double* x, int i, int n, const int* pedestal)
+{
+	const __m128d nd = _mm_set1_pd(NoData<double>::value());
+	for(; i+2 <= n; i += 2) {
+		const __m128d v = _mm_loadu_pd(x+i);
+		const __m128d p = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pedestal+i)));
+		_mm_storeu_pd(x+i, select(_mm_cmpneq_pd(v, nd), _mm_sub_pd(v, p), v));
+	}
+	pedestal_subtract<double>(x, i, n, pedestal);
+}
+template <class T2>
+inline void zero_suppress1(double* x, int i, int n, const T2& threshold)
+{
+	const __m128d nd = _mm_set1_pd(NoData<double>::value());
+	const __m128d th = _mm_set1_pd(threshold);
+	for(; i+2 <= n; i += 2) {
+		const __m128d v = _mm_loadu_pd(x+i);
+		const __m128d m = _mm_and_pd(_mm_cmpneq_pd(v, nd), _mm_cmplt_pd(v, th));
+		_mm_storeu_pd(x+i, _mm_andnot_pd(m, v));
+	}
+	zero_suppress1<double, T2>(x, i, n, threshold);
+}
+inline void linear_calibrate(double* x, int i, int n, const double* offset, const double* slope)
+{
+	const __m128d nd = _mm_set1_pd(NoData<double>::value());
+	for(; i+2 <= n; i += 2) {
+		const __m128d v = _mm_loadu_pd(x+i);
+		const __m128d r = _mm_add_pd(_mm_loadu_pd(offset+i), _mm_mul_pd(v, _mm_loadu_pd(slope+i)));
+		_mm_storeu_pd(x+i, select(_mm_cmpneq_pd(v, nd), r, v));
+	}
+	linear_calibrate<double>(x, i, n, offset, slope);
+}
+inline void quadratic_calibrate(double* x, int i, int n, const double* offset, const double* slope, const double* slope2)
+{
+	const __m128d nd = _mm_set1_pd(NoData<double>::value());
+	for(; i+2 <= n; i += 2) {
+		const __m128d v  = _mm_loadu_pd(x+i);
+		const __m128d r1 = _mm_add_pd(_mm_loadu_pd(offset+i), _mm_mul_pd(v, _mm_loadu_pd(slope+i)));
+		const __m128d r  = _mm_add_pd(r1, _mm_mul_pd(_mm_mul_pd(v, v), _mm_loadu_pd(slope2+i)));
+		_mm_storeu_pd(x+i, select(_mm_cmpneq_pd(v, nd), r, v));
+	}
+	quadratic_calibrate<double>(x, i, n, offset, slope, slope2);
+}
+#endif
+} // namespace masked
+#endif
+
+/// Perform pedestal subtraction on a fixed-size array of AdcVariables<N>
+/*!
+ * Chosen over the generic array version whenever the variables are an
+ * AdcVariables<N>; same result, but uses the branch-free masked kernels.
+ * When `length == N` the trip count is a compile-time constant.
+ */
+template <class T, class L, int N>
+inline void pedestal_subtract(T* array, L length, const AdcVariables<N>& variables)
+{
+	if(length == N) masked::pedestal_subtract(array, 0, N, variables.pedestal);
+	else            masked::pedestal_subtract(array, 0, length, variables.pedestal);
+}
+
+/// Perform pedestal subtraction on a fixed-size array of AdcVariables2<N>
+template <class T, class L, int N>
+inline void pedestal_subtract(T* array, L length, const AdcVariables2<N>& variables)
+{
+	if(length == N) masked::pedestal_subtract(array, 0, N, variables.pedestal);
+	else            masked::pedestal_subtract(array, 0, length, variables.pedestal);
+}
+
+/// Perform linear calibration on a fixed-size array of AdcVariables<N>
+/*! See pedestal_subtract(T*, L, const AdcVariables<N>&) */
+template <class T, class L, int N>
+inline void linear_calibrate(T* array, L length, const AdcVariables<N>& variables)
+{
+	if(length == N) masked::linear_calibrate(array, 0, N, variables.offset, variables.slope);
+	else            masked::linear_calibrate(array, 0, length, variables.offset, variables.slope);
+}
+
+/// Perform linear calibration on a fixed-size array of TdcVariables<N>
+/*! See pedestal_subtract(T*, L, const AdcVariables<N>&) */
+template <class T, class L, int N>
+inline void linear_calibrate(T* array, L length, const TdcVariables<N>& variables)
+{
+	if(length == N) masked::linear_calibrate(array, 0, N, variables.offset, variables.slope);
+	else            masked::linear_calibrate(array, 0, length, variables.offset, variables.slope);
+}
+
+/// Perform quadratic calibration on a fixed-size array of AdcVariables2<N>
+/*! See pedestal_subtract(T*, L, const AdcVariables<N>&) */
+template <class T, class L, int N>
+inline void quadratic_calibrate(T* array, L length, const AdcVariables2<N>& variables)
+{
+	if(length == N) masked::quadratic_calibrate(array, 0, N, variables.offset, variables.slope, variables.slope2);
+	else            masked::quadratic_calibrate(array, 0, length, variables.offset, variables.slope, variables.slope2);
+}
+
+/// Perform quadratic calibration on a fixed-size array of TdcVariables2<N>
+/*! See pedestal_subtract(T*, L, const AdcVariables<N>&) */
+template <class T, class L, int N>
+inline void quadratic_calibrate(T* array, L length, const TdcVariables2<N>& variables)
+{
+	if(length == N) masked::quadratic_calibrate(array, 0, N, variables.offset, variables.slope, variables.slope2);
+	else            masked::quadratic_calibrate(array, 0, length, variables.offset, variables.slope, variables.slope2);
+}
+
+/// Perform zero suppression on an array of compile-time size `N`
+/*!
+ * Branch-free version of zero_suppress1(T*, L, const T2&), selected by giving
+ * the array size as a template argument:
+ * \code
+ * double ecal[30];
+ * utils::zero_suppress1<30>(ecal, 10.);
+ * \endcode
+ */
+template <int N, class T, class T2>
+inline void zero_suppress1(T* values, const T2& threshold)
+{
+	masked::zero_suppress1(values, 0, N, threshold);
+}
+#endif // #ifndef __MAKECINT__
+
 #ifndef __MAKECINT__
 #ifndef DOXYGEN_SKIP
 namespace {
@@ -0,0 +1,165 @@
+///
+/// \file GatherPlan.hxx
+/// \author G. Christian
+/// \brief Defines a flattened channel map from vme module data into detector arrays
+///
+#ifndef DRAGON_UTILS_GATHER_PLAN_HXX
+#define DRAGON_UTILS_GATHER_PLAN_HXX
+#include <vector>
+#include <cstring>
+#include "utils/IntTypes.h"
+#include "ErrorDragon.hxx"
+
+namespace dragon { namespace utils {
+
+/// Flattened version of channel_map() from an array of modules
+/*!
+ * The (channel, module) mapping in a detector's variables is resolved once,
+ * when the plan is built (usually from `set_variables()`), into a list of
+ * (source, destination) byte offsets: source relative to the start of the
+ * module array, destination relative to a base object (e.g. dragon::Tail)
+ * containing the output arrays. Filling all outputs is then a single loop
+ * of plain copies:
+ * \code
+ * dutils::GatherPlan<vme::V785> plan;
+ * plan.add(this, dsssd.ecal, Dsssd::MAX_CHANNELS, channels, modules, v785, NUM_ADC);
+ * // ... every event:
+ * plan.gather(v785, this);
+ * \endcode
+ * Mappings pointing outside of the module array or the module's channels are
+ * reported when the plan is built and left out, so their outputs keep their
+ * reset (invalid) value, the same result as channel_map().
+ *
+ * Offsets are relative, so a plan stays valid for copies of the base object.
+ *
+ * The plan keeps a copy of the channel and module mappings it was built from,
+ * which must be inside of the base object (usually in its variables). If they
+ * are changed by hand afterwards, is_current() returns false and the plan needs
+ * to be rebuilt:
+ * \code
+ * if(!plan.is_current(this)) build_plan();
+ * \endcode
+ *
+ * \tparam M Module type, must have a public `data[]` array and a `MAX_CHANNELS` constant
+ */
+template <class M>
+class GatherPlan {
+public:
+	/// Remove all entries
+	void clear() { fEntries.clear(); fWatches.clear(); fWatched.clear(); }
+	/// Number of entries
+	int size() const { return fEntries.size(); }
+
+	/// Add an array of outputs to the plan
+	/*!
+	 * \param base Base object containing the outputs
+	 * \param output Array of outputs, inside of `base`
+	 * \param numch Number of outputs
+	 * \param channels Channel mapping of the outputs, inside of `base`
+	 * \param modules Module mapping of the outputs, inside of `base`
+	 * \param moduleArr Array of modules the plan will be used with
+	 * \param numModules Length of `moduleArr`
+	 */
+	void add(const void* base, double* output, int numch, const int* channels, const int* modules,
+					 const M* moduleArr, int numModules)
+		{
+			watch(base, channels, numch);
+			watch(base, modules, numch);
+			for(int i=0; i< numch; ++i)
+				add_entry(base, output[i], channels[i], modules[i], moduleArr, numModules);
+		}
+
+	/// Add a single output to the plan, `channel` and `module` being inside of `base`
+	void add(const void* base, double& output, const int& channel, const int& module, const M* moduleArr, int numModules)
+		{
+			watch(base, &channel, 1);
+			watch(base, &module, 1);
+			add_entry(base, output, channel, module, moduleArr, numModules);
+		}
+
+	/// Check that the plan was built, from the mappings now in `base`
+	bool is_current(const void* base) const
+		{
+			if(fWatches.empty()) return false;
+			const char* const pbase = reinterpret_cast<const char*>(base);
+			for(size_t i=0; i< fWatches.size(); ++i) {
+				const Watch& w = fWatches[i];
+				if(memcmp(pbase + w.fOffset, &fWatched[w.fFirst], w.fCount*sizeof(int)) != 0)
+					return false;
+			}
+			return true;
+		}
+
+	/// Copy module data into the outputs
+	/*!
+	 * \param moduleArr Array of modules, laid out as the one given to add()
+	 * \param base Base object, of the same type as the one given to add()
+	 */
+	void gather(const M* moduleArr, void* base) const
+		{
+			if(fEntries.empty()) return;
+			do_gather(reinterpret_cast<const char*>(moduleArr), reinterpret_cast<char*>(base), moduleArr[0].data);
+		}
+
+private:
+	/// Add a single output
+	void add_entry(const void* base, double& output, int channel, int module, const M* moduleArr, int numModules)
+		{
+			if(module < 0 || module >= numModules || channel < 0 || channel >= M::MAX_CHANNELS) {
+				Warning("dragon::utils::GatherPlan::add")
+					<< "Invalid mapping: module " << module << " (valid range: [0, " << numModules - 1
+					<< "]), channel " << channel << " (valid range: [0, " << M::MAX_CHANNELS - 1
+					<< "]). This parameter will never contain data.";
+				return;
+			}
+			Entry entry;
+			entry.fSrc = reinterpret_cast<const char*>(&moduleArr[module].data[channel]) - reinterpret_cast<const char*>(moduleArr);
+			entry.fDst = reinterpret_cast<const char*>(&output) - reinterpret_cast<const char*>(base);
+			fEntries.push_back(entry);
+		}
+
+	/// Remember the current values of a mapping array inside of `base`
+	void watch(const void* base, const int* values, int n)
+		{
+			Watch w;
+			w.fOffset = reinterpret_cast<const char*>(values) - reinterpret_cast<const char*>(base);
+			w.fFirst = fWatched.size();
+			w.fCount = n;
+			fWatches.push_back(w);
+			fWatched.insert(fWatched.end(), values, values + n);
+		}
+
+	/// Gather loop, `D` is the type of the module data
+	template <class D>
+	void do_gather(const char* src, char* dst, const D*) const
+		{
+			const Entry* entry = &fEntries[0];
+			const Entry* const end = entry + fEntries.size();
+			for(; entry != end; ++entry)
+				*reinterpret_cast<double*>(dst + entry->fDst) = *reinterpret_cast<const D*>(src + entry->fSrc);
+		}
+
+private:
+	/// Source and destination byte offsets
+	struct Entry {
+		int32_t fSrc;
+		int32_t fDst;
+	};
+	/// All entries
+	std::vector<Entry> fEntries;
+	/// Mapping array the plan was built from
+	struct Watch {
+		int32_t fOffset; ///< Byte offset in the base object
+		int32_t fFirst;  ///< First value in fWatched
+		int32_t fCount;  ///< Number of values
+	};
+	/// All mapping arrays
+	std::vector<Watch> fWatches;
+	/// Values of the mapping arrays when the plan was built
+	std::vector<int> fWatched;
+};
+
+} } // namespace dragon namespace utils
+
+
+#endif
@@ -0,0 +1,106 @@
+///
+/// \file NTupleWriter.cxx
+/// \author G. Christian
+/// \brief Implements NTupleWriter.hxx
+///
+#include <TFile.h>
+#include "ErrorDragon.hxx"
+#include "OutputProfile.hxx"
+#include "NTupleWriter.hxx"
+
+#ifdef DRAGON_HAVE_RNTUPLE
+#include <memory>
+#include <stdexcept>
+#include <ROOT/REntry.hxx>
+#include <ROOT/RField.hxx>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#include <ROOT/RNTupleWriteOptions.hxx>
+
+namespace {
+// RNTuple classes left ROOT::Experimental in 6.36
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+namespace rnt = ROOT;
+#else
+namespace rnt = ROOT::Experimental;
+#endif
+}
+
+struct dragon::NTupleWriter::Impl {
+	std::unique_ptr<rnt::RNTupleWriter> fWriter;
+	std::unique_ptr<rnt::REntry> fEntry;
+};
+#else
+struct dragon::NTupleWriter::Impl { };
+#endif
+
+namespace dutils = dragon::utils;
+
+
+// ====================== Class dragon::NTupleWriter ====================== //
+
+dragon::NTupleWriter::NTupleWriter(const char* name, const char* fieldName, const char* className, void* addr,
+																	 TFile& file, const OutputProfile& profile):
+	fImpl(0)
+{
+	/*!
+	 * \param [in] name Name of the RNTuple in the file
+	 * \param [in] fieldName Name of the top-level field
+	 * \param [in] className Class of the object written (must have a dictionary)
+	 * \param [in] addr Address of the object, filled before each call to Fill()
+	 * \param [in] file Output file
+	 * \param [in] profile Output profile, of which only the compression applies
+	 */
+#ifdef DRAGON_HAVE_RNTUPLE
+	try {
+		std::unique_ptr<rnt::RNTupleModel> model = rnt::RNTupleModel::Create();
+		model->AddField(rnt::RFieldBase::Create(fieldName, className).Unwrap());
+
+		rnt::RNTupleWriteOptions options;
+		const int compression = file.GetCompressionSettings();
+		options.SetCompression(profile.fAlgorithm == OutputProfile::kInherit && profile.fLevel < 0 ?
+													 compression : 100*profile.fAlgorithm + (profile.fLevel < 0 ? compression % 100 : profile.fLevel));
+
+		Impl* impl = new Impl();
+		impl->fWriter = rnt::RNTupleWriter::Append(std::move(model), name, file, options);
+		impl->fEntry = impl->fWriter->CreateEntry();
+		impl->fEntry->BindRawPtr(fieldName, addr);
+		fImpl = impl;
+	}
+	catch (std::exception& e) {
+		dutils::Error("NTupleWriter::NTupleWriter", __FILE__, __LINE__)
+			<< "Couldn't create RNTuple \"" << name << "\" of class " << className << ": " << e.what();
+	}
+#else
+	dutils::Error("NTupleWriter::NTupleWriter", __FILE__, __LINE__)
+		<< "RNTuple output needs ROOT 6.34 or later, \"" << name << "\" will not be written";
+#endif
+}
+
+dragon::NTupleWriter::~NTupleWriter()
+{
+	Commit();
+}
+
+void dragon::NTupleWriter::Fill()
+{
+#ifdef DRAGON_HAVE_RNTUPLE
+	if(fImpl) fImpl->fWriter->Fill(*fImpl->fEntry);
+#endif
+}
+
+void dragon::NTupleWriter::Commit()
+{
+	/*! Nothing can be filled after this. */
+	delete fImpl; // the writer commits when destroyed
+	fImpl = 0;
+}
+
+Bool_t dragon::NTupleWriter::IsAvailable()
+{
+#ifdef DRAGON_HAVE_RNTUPLE
+	return kTRUE;
+#else
+	return kFALSE;
+#endif
+}
@@ -0,0 +1,67 @@
+///
+/// \file NTupleWriter.hxx
+/// \author G. Christian
+/// \brief Defines a class writing DRAGON event classes as RNTuple columns.
+///
+#ifndef DRAGON_NTUPLE_WRITER_HXX
+#define DRAGON_NTUPLE_WRITER_HXX
+#include <RVersion.h>
+#include <Rtypes.h>
+
+/// RNTuple output is available (ROOT 6.34 and later, first stable on-disk format)
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,34,0)
+#define DRAGON_HAVE_RNTUPLE
+#endif
+
+class TFile;
+
+namespace dragon {
+
+class OutputProfile;
+
+/// Writes one event class to an RNTuple, as `mid2root --rntuple` does
+/*!
+ * The RNTuple has a single top-level field holding the whole object, named
+ * as the branch of the equivalent TTree, so its columns are named as the tree's
+ * leaves (e.g. `head.bgo.esort`): RDataFrame expressions work the same on
+ * either. Members marked transient (`//!`) are not written.
+ *
+ * \code
+ * dragon::Head head;
+ * dragon::NTupleWriter t1("t1", "head", "dragon::Head", &head, file, profile);
+ * // ... unpack into `head`
+ * t1.Fill();
+ * \endcode
+ *
+ * Without RNTuple support (see IsAvailable()), nothing is written.
+ */
+class NTupleWriter {
+public:
+	/// Create an RNTuple in a file
+	NTupleWriter(const char* name, const char* fieldName, const char* className, void* addr,
+							 TFile& file, const OutputProfile& profile);
+	/// Commit the RNTuple to the file
+	~NTupleWriter();
+	/// Write the current contents of the object
+	void Fill();
+	/// Commit the RNTuple to the file now, before the file is closed
+	void Commit();
+	/// Check if RNTuple output is available in this version of ROOT
+	static Bool_t IsAvailable();
+
+private:
+	/// Disable copy
+	NTupleWriter(const NTupleWriter&) { }
+	/// Disable assign
+	NTupleWriter& operator= (const NTupleWriter&) { return *this; }
+
+private:
+	/// RNTuple writer and entry, NULL once committed
+	struct Impl;
+	Impl* fImpl; //!
+};
+
+} // namespace dragon
+
+
+#endif
@@ -0,0 +1,342 @@
+///
+/// \file OutputProfile.cxx
+/// \author G. Christian
+/// \brief Implements OutputProfile.hxx
+///
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TObjArray.h>
+#include <RVersion.h>
+#include "midas/XmlTree.hxx"
+#include "ErrorDragon.hxx"
+#include "OutputProfile.hxx"
+
+namespace dutils = dragon::utils;
+
+
+namespace {
+
+/// Parse an integer attribute, if present
+template <class T>
+bool read_number(const midas::XmlNode* node, const char* attribute, T& value)
+{
+	const char* str = node->GetAttribute(attribute);
+	if(!str) return true;
+	char* end;
+	const long long val = strtoll(str, &end, 0);
+	if(end == str || *end) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "Invalid value of \"" << attribute << "\" (line " << node->line_number << "): \"" << str << "\"";
+		return false;
+	}
+	value = val;
+	return true;
+}
+
+/// Build a built-in profile
+dragon::OutputProfile builtin(const char* name, Int_t algorithm, Int_t level, Int_t basket, Long64_t autoflush, bool dropModules)
+{
+	dragon::OutputProfile profile;
+	profile.fName = name;
+	profile.fAlgorithm = algorithm;
+	profile.fLevel = level;
+	profile.fBasketSize = basket;
+	profile.fAutoFlush = autoflush;
+	if(dropModules) {
+		const char* const modules[] = { "io32", "v792", "v785", "v1190" };
+		profile.fDrop.assign(modules, modules + sizeof(modules) / sizeof(modules[0]));
+	}
+	return profile;
+}
+
+/// Check if a branch name refers to a member, or to something inside it
+/*!
+ * The member is matched as whole dot-separated components, at any depth and
+ * ignoring array dimensions: "dsssd" matches "dsssd", "dsssd.ecal[32]" and
+ * "tail.dsssd.efront", but not "dsssd2".
+ */
+bool is_member_branch(const char* branchName, const std::string& member)
+{
+	std::string name(branchName);
+	name = name.substr(0, name.find('['));
+	for(size_t pos = name.find(member); pos != std::string::npos; pos = name.find(member, pos + 1)) {
+		const size_t end = pos + member.size();
+		if((pos == 0 || name[pos-1] == '.') && (end == name.size() || name[end] == '.'))
+			return true;
+	}
+	return false;
+}
+
+/// Take the leaves of a branch and its sub-branches out of the tree's list of leaves
+void remove_leaves(TTree* tree, TBranch* branch)
+{
+	TObjArray* leaves = branch->GetListOfLeaves();
+	for(Int_t i=0; i<= leaves->GetLast(); ++i)
+		tree->GetListOfLeaves()->Remove(leaves->At(i));
+	TObjArray* branches = branch->GetListOfBranches();
+	for(Int_t i=0; i<= branches->GetLast(); ++i)
+		if(branches->At(i)) remove_leaves(tree, static_cast<TBranch*>(branches->At(i)));
+}
+
+/// Remove the branches of a member from a list of branches, recursively
+Int_t remove_branches(TTree* tree, TObjArray* branches, const std::string& member)
+{
+	Int_t removed = 0;
+	for(Int_t i=0; i<= branches->GetLast(); ++i) {
+		TBranch* branch = static_cast<TBranch*>(branches->At(i));
+		if(!branch) continue;
+		if(!is_member_branch(branch->GetName(), member)) {
+			removed += remove_branches(tree, branch->GetListOfBranches(), member);
+			continue;
+		}
+		remove_leaves(tree, branch);
+		branches->RemoveAt(i);
+		delete branch;
+		++removed;
+	}
+	branches->Compress();
+	return removed;
+}
+
+/// All built-in profiles
+const std::vector<dragon::OutputProfile>& builtins()
+{
+	typedef dragon::OutputProfile P;
+	static std::vector<dragon::OutputProfile> profiles;
+	if(profiles.empty()) {
+		// Same as before profiles existed: ROOT defaults throughout
+		profiles.push_back(builtin("default", P::kInherit, -1, 32000, -30000000, false));
+		// Fast to write and read back, no raw VME data
+		profiles.push_back(builtin("quicklook", P::IsAvailable(P::kLZ4) ? P::kLZ4 : P::kZLIB, 1, 32000, -30000000, true));
+		// Smallest files: larger baskets and clusters compress better
+		profiles.push_back(builtin("archive", P::IsAvailable(P::kZSTD) ? P::kZSTD : P::kLZMA, P::IsAvailable(P::kZSTD) ? 9 : 8, 256000, -100000000, false));
+	}
+	return profiles;
+}
+
+} // namespace
+
+
+// ====================== Class dragon::OutputProfile ====================== //
+
+dragon::OutputProfile::OutputProfile():
+	fName("default"), fAlgorithm(kInherit), fLevel(-1),
+	fSplitLevel(99), fBasketSize(32000), fAutoFlush(-30000000)
+{ }
+
+Bool_t dragon::OutputProfile::Get(const std::string& spec, OutputProfile& profile)
+{
+	/*!
+	 * \param [in] spec Name of a built-in profile, or `file.xml` (the first
+	 *  profile in the file), or `file.xml:name`
+	 * \param [out] profile The profile found; unchanged if none
+	 * \returns true if the profile was found
+	 */
+	const std::string::size_type xml = spec.find(".xml");
+	if(xml != std::string::npos) {
+		const std::string file = spec.substr(0, xml + 4);
+		std::string name = spec.substr(xml + 4);
+		if(!name.empty() && name[0] == ':') name.erase(0, 1);
+		return Read(file.c_str(), name.empty() ? 0 : name.c_str(), profile);
+	}
+
+	const std::vector<OutputProfile>& profiles = builtins();
+	for(size_t i=0; i< profiles.size(); ++i) {
+		if(profiles[i].fName == spec) {
+			profile = profiles[i];
+			return true;
+		}
+	}
+	dutils::Error("OutputProfile::Get", __FILE__, __LINE__)
+		<< "Unknown output profile \"" << spec << "\"";
+	return false;
+}
+
+Bool_t dragon::OutputProfile::Read(const char* filename, const char* name, OutputProfile& profile)
+{
+	/*!
+	 * \param [in] filename XML file, see the class description for the format
+	 * \param [in] name Name of the profile, NULL for the first one in the file
+	 * \param [out] profile The profile read; unchanged if none
+	 * \returns true if the profile was read
+	 */
+	std::ifstream ifs(filename, std::ios::binary);
+	if(!ifs.good()) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "Couldn't open the file \"" << filename << "\"";
+		return false;
+	}
+	const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	midas::XmlTree tree;
+	char error[256];
+	int errorLine;
+	if(!tree.Parse(text.c_str(), text.size(), error, sizeof(error), &errorLine)) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "Couldn't parse \"" << filename << "\": " << error;
+		return false;
+	}
+
+	midas::XmlNode* top = midas::XmlTree::FindChild(tree.GetRoot(), "profiles");
+	midas::XmlNode* node = name ?
+		midas::XmlTree::FindChild(top, "profile", name) : midas::XmlTree::FindChild(top, "profile");
+	if(!node) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "No <profile" << (name ? std::string(" name=\"") + name + "\"" : std::string()) << "> in <profiles> of \""
+			<< filename << "\"";
+		return false;
+	}
+
+	OutputProfile p;
+	const char* attribute = node->GetAttribute("name");
+	p.fName = attribute ? attribute : "";
+	attribute = node->GetAttribute("compression");
+	if(attribute && !ParseAlgorithm(attribute, p.fAlgorithm)) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "Unknown compression algorithm \"" << attribute << "\" (line " << node->line_number << ")";
+		return false;
+	}
+	if(!IsAvailable(p.fAlgorithm)) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "Compression algorithm \"" << attribute << "\" is not available in ROOT " << ROOT_RELEASE;
+		return false;
+	}
+	bool success = read_number(node, "level", p.fLevel);
+	if(success) success = read_number(node, "split", p.fSplitLevel);
+	if(success) success = read_number(node, "basket", p.fBasketSize);
+	if(success) success = read_number(node, "autoflush", p.fAutoFlush);
+	if(!success) return false;
+
+	for(const midas::XmlNode* child = node->child; child; child = child->next) {
+		if(strcmp(child->name, "drop")) continue;
+		const char* branch = child->GetAttribute("branch");
+		if(!branch) {
+			dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+				<< "<drop> without \"branch\" (line " << child->line_number << ")";
+			return false;
+		}
+		p.fDrop.push_back(branch);
+	}
+	if(!p.fDrop.empty() && p.fSplitLevel == 0) {
+		dutils::Error("OutputProfile::Read", __FILE__, __LINE__)
+			<< "<drop> needs a split level above 0 (line " << node->line_number << "): with split=\"0\" "
+			<< "each event is a single branch, and no member can be left out";
+		return false;
+	}
+
+	profile = p;
+	return true;
+}
+
+std::vector<std::string> dragon::OutputProfile::GetBuiltinNames()
+{
+	std::vector<std::string> names;
+	for(size_t i=0; i< builtins().size(); ++i)
+		names.push_back(builtins()[i].fName);
+	return names;
+}
+
+Bool_t dragon::OutputProfile::ParseAlgorithm(const char* name, Int_t& algorithm)
+{
+	/*! \returns false if \e name is unknown (and \e algorithm is unchanged) */
+	static const struct { const char* name; Int_t algorithm; } algorithms[] = {
+		{ "inherit", kInherit }, { "zlib", kZLIB }, { "lzma", kLZMA }, { "lz4", kLZ4 }, { "zstd", kZSTD }
+	};
+	for(size_t i=0; i< sizeof(algorithms) / sizeof(algorithms[0]); ++i) {
+		if(!strcmp(algorithms[i].name, name)) {
+			algorithm = algorithms[i].algorithm;
+			return true;
+		}
+	}
+	return false;
+}
+
+Bool_t dragon::OutputProfile::IsAvailable(Int_t algorithm)
+{
+	switch(algorithm) {
+	case kInherit: case kZLIB: case kLZMA:
+		return true;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,12,0)
+	case kLZ4:
+		return true;
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+	case kZSTD:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+void dragon::OutputProfile::ApplyTo(TFile* file) const
+{
+	/*!
+	 * Branches take the compression of the file when they are created, so this
+	 * must be called before creating the trees.
+	 */
+	if(fAlgorithm != kInherit) file->SetCompressionAlgorithm(fAlgorithm);
+	if(fLevel >= 0) file->SetCompressionLevel(fLevel);
+}
+
+TBranch* dragon::OutputProfile::MakeBranch(TTree* tree, const char* name, const char* classname, void* addr) const
+{
+	/*! \param addr Address of a pointer to the object, as for TTree::Branch() */
+	return tree->Branch(name, classname, addr, fBasketSize, fSplitLevel);
+}
+
+void dragon::OutputProfile::ApplyTo(TTree* tree) const
+{
+	/*!
+	 * Dropped members are removed from the tree with RemoveBranches(), as for
+	 * `mid2root --disable`, so they never become branches in the file. Must be
+	 * called before the tree is first filled.
+	 */
+	tree->SetAutoFlush(fAutoFlush);
+	for(size_t i=0; i< fDrop.size(); ++i)
+		RemoveBranches(tree, fDrop[i]);
+}
+
+Int_t dragon::OutputProfile::RemoveBranches(TTree* tree, const std::string& member)
+{
+	/*!
+	 * Removes every branch whose name refers to \e member, or to something
+	 * inside it, at any depth: "dsssd" removes `dsssd`, `dsssd.ecal[32]`,
+	 * `tail.dsssd.efront` and so on. The branches are deleted and their leaves
+	 * taken out of the tree, so the member is absent from the file rather than
+	 * written empty. This must be done before the tree is first filled.
+	 *
+	 * Members can only be removed if they have branches of their own: with
+	 * split level 0, the whole object is streamed into one branch and nothing
+	 * is removed.
+	 *
+	 * \returns The number of branches removed (not counting sub-branches)
+	 */
+	const Int_t removed = remove_branches(tree, tree->GetListOfBranches(), member);
+	tree->GetListOfLeaves()->Compress();
+	return removed;
+}
+
+std::string dragon::OutputProfile::Describe() const
+{
+	static const char* const algorithms[] = { "inherit", "zlib", "lzma", "old", "lz4", "zstd" };
+	std::stringstream s;
+	s << fName << ": compression ";
+	if(fAlgorithm >= 0 && fAlgorithm < (Int_t)(sizeof(algorithms) / sizeof(algorithms[0])))
+		s << algorithms[fAlgorithm];
+	else
+		s << fAlgorithm;
+	if(fLevel >= 0) s << "-" << fLevel;
+	s << ", split " << fSplitLevel << ", basket " << fBasketSize << " B, auto-flush " << fAutoFlush;
+	if(!fDrop.empty()) {
+		s << ", drop";
+		for(size_t i=0; i< fDrop.size(); ++i) s << (i ? "," : " ") << fDrop[i];
+	}
+	return s.str();
+}
@@ -0,0 +1,100 @@
+///
+/// \file OutputProfile.hxx
+/// \author G. Christian
+/// \brief Defines a class setting the layout and compression of the
+///  trees written by `mid2root`.
+///
+#ifndef DRAGON_OUTPUT_PROFILE_HXX
+#define DRAGON_OUTPUT_PROFILE_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+
+class TFile;
+class TTree;
+class TBranch;
+class TObjArray;
+
+namespace dragon {
+
+/// Layout and compression of the trees written by `mid2root`
+/*!
+ * A profile sets the compression algorithm and level of the output file, the
+ * split level and basket size of each branch, the auto-flush setting of each
+ * tree, and which members of the event classes become branches.
+ *
+ * Profiles are either built in (see Get()) or read from an XML file:
+ * \code
+ * <profiles>
+ *   <profile name="quicklook" compression="lz4" level="1" split="99" basket="32000" autoflush="-30000000">
+ *     <drop branch="io32"/>
+ *     <drop branch="v1190"/>
+ *   </profile>
+ * </profiles>
+ * \endcode
+ * Attributes left out keep the values of the "default" profile. Dropped
+ * members are matched by name at any depth, along with their sub-branches:
+ * `io32` removes `io32`, `io32.*`, `head.io32` and so on (see
+ * RemoveBranches()). They are removed from the trees before the first fill,
+ * so they do not appear in the file at all. This needs a split level above
+ * 0, and Read() rejects `<drop>` with `split="0"`. Only members that are
+ * written at all can be dropped; VME modules are written only if compiled
+ * with DISPLAY_MODULES.
+ */
+class OutputProfile {
+public:
+	/// Compression algorithms (values as in ROOT::ECompressionAlgorithm)
+	enum Algorithm_t {
+		kInherit = 0, ///< Keep the file default
+		kZLIB    = 1, ///< ZLIB
+		kLZMA    = 2, ///< LZMA: best compression, slowest
+		kLZ4     = 4, ///< LZ4: fastest (ROOT 6.12 and later)
+		kZSTD    = 5  ///< ZSTD: good compression at moderate speed (ROOT 6.20 and later)
+	};
+
+public:
+	/// Same as the "default" profile
+	OutputProfile();
+	/// Look up a profile by name, in the built-in profiles or an XML file
+	static Bool_t Get(const std::string& spec, OutputProfile& profile);
+	/// Read a profile from an XML file
+	static Bool_t Read(const char* filename, const char* name, OutputProfile& profile);
+	/// Names of the built-in profiles
+	static std::vector<std::string> GetBuiltinNames();
+	/// Convert an algorithm name ("zlib", "lzma", "lz4", "zstd") to Algorithm_t
+	static Bool_t ParseAlgorithm(const char* name, Int_t& algorithm);
+	/// Check if an algorithm is supported by this version of ROOT
+	static Bool_t IsAvailable(Int_t algorithm);
+
+	/// Set the compression of a file, before creating trees in it
+	void ApplyTo(TFile* file) const;
+	/// Create a branch with the profile's split level and basket size
+	TBranch* MakeBranch(TTree* tree, const char* name, const char* classname, void* addr) const;
+	/// Set auto-flush and dropped branches of a tree, after creating its branches
+	void ApplyTo(TTree* tree) const;
+	/// Remove the branches of a member (and their sub-branches) from a tree, before it is first filled
+	static Int_t RemoveBranches(TTree* tree, const std::string& member);
+	/// One-line description
+	std::string Describe() const;
+
+public:
+	/// Name
+	std::string fName;
+	/// Compression algorithm (Algorithm_t)
+	Int_t fAlgorithm;
+	/// Compression level, 0-9 (-1 to keep the file default)
+	Int_t fLevel;
+	/// Branch split level
+	Int_t fSplitLevel;
+	/// Basket size [bytes]
+	Int_t fBasketSize;
+	/// Auto-flush setting, as in TTree::SetAutoFlush()
+	Long64_t fAutoFlush;
+	/// Names of members that do not become branches
+	std::vector<std::string> fDrop;
+};
+
+} // namespace dragon
+
+
+#endif
@@ -6,7 +6,9 @@
 #include <vector>
 #include <string>
 #include <cassert>
+#include <cstring>
 #include <sstream>
+#include <limits>
 #include <numeric>
 #include <algorithm>
 
@@ -21,15 +23,21 @@
 #include <TFitResult.h>
 #include <TDataMember.h>
 #include <TTreeFormula.h>
+#include <TKey.h>
 
 #include "midas/Database.hxx"
 #include "utils/Functions.hxx"
 #include "Dragon.hxx"
+#include "EpicsSeries.hxx"
+#include "ScalerIndex.hxx"
 #include "Constants.hxx"
 #include "ErrorDragon.hxx"
 #include "LinearFitter.hxx"
 #include "TAtomicMass.h"
 #include "RootAnalysis.hxx"
+#ifdef DRAGON_HAVE_RDATAFRAME
+#include <ROOT/RDataFrame.hxx>
+#endif
 
 namespace dutils = dragon::utils;
 
@@ -37,6 +45,9 @@ namespace dutils = dragon::utils;
 namespace {
   // Alias for surface barrier max channels
   const Int_t NSB = dragon::SurfaceBarrier::MAX_CHANNELS;
+  // Default tail scaler channels of the surface barriers: SB 0 is on channel 10
+  // (see examples/Selectors.C), SB 1 has no known channel
+  const Int_t kSbScaler0 = 10, kSbScaler1 = -1;
   // Get a branch from a tree and print an error message if input is bad
   template <typename T>
   TBranch* get_branch(TTree* t, T& valref, const char* name, const char* funcname = "") {
@@ -85,6 +96,12 @@ namespace {
 	delete t;
 	t = 0;
   }
+  // Check if a file holds an RNTuple (written by `mid2root --rntuple`) by a given name
+  Bool_t is_ntuple(TFile& file, const char* name)
+  {
+	TKey* key = file.GetKey(name);
+	return key && TString(key->GetClassName()).Contains("RNTuple");
+  }
 } // namespace
 
 //////////////////////// namespace dragon Free Functions ///////////////////////
@@ -123,6 +140,11 @@ void dragon::MakeChains(const char* prefix, const Int_t* runnumbers, Int_t nruns
           dutils::Warning("MakeChains", __FILE__, __LINE__)
             << "Skipping run " << runnumbers[i] << ", could not find file " << fname;
         }
+        else if(is_ntuple(file, "t3")) {
+          dutils::Warning("MakeChains", __FILE__, __LINE__)
+            << "Run " << runnumbers[i] << " is stored as RNTuples, which can't be chained; "
+            << "use dragon::MakeFrame() instead";
+        }
       }
       for(int j=0; j< nchains; ++j) {
         chain[j]->AddFile(fname);
@@ -158,6 +180,11 @@ void dragon::MakeChains(const char* prefix, const Int_t* runnumbers, Int_t nruns
           dutils::Warning("MakeChains", __FILE__, __LINE__)
             << "Skipping run " << runnumbers[i] << ", could not find file " << fname;
         }
+        else if(is_ntuple(file, "t3")) {
+          dutils::Warning("MakeChains", __FILE__, __LINE__)
+            << "Run " << runnumbers[i] << " is stored as RNTuples, which can't be chained; "
+            << "use dragon::MakeFrame() instead";
+        }
       }
       for(int j=0; j< nchains; ++j) {
         chain[j]->AddFile(fname);
@@ -198,6 +225,39 @@ void dragon::MakeChains(const std::vector<Int_t>& runnumbers, const char* format
   MakeChains(&runnumbers[0], runnumbers.size(), format, sonik);
 }
 
+#ifdef DRAGON_HAVE_RDATAFRAME
+////////////////////////////////////////////////////////////////////////////////
+/// Open one event type from multiple DRAGON files as an RDataFrame
+/// \param name Name of the tree or RNTuple, e.g. "t3"
+/// \param runnumbers vector of desired run numbers
+/// \param format same as for MakeChains()
+///
+/// Works on files written by `mid2root` with or without `--rntuple`; column
+/// names are the same for both (e.g. "tail.dsssd.efront").
+///
+/// \note The returned RDataFrame is heap-allocated and must be deleted by the user.
+ROOT::RDataFrame* dragon::MakeFrame(const char* name, const std::vector<Int_t>& runnumbers,
+                                    const char* format)
+{
+  std::vector<std::string> files;
+  for(size_t i=0; i< runnumbers.size(); ++i) {
+    TString fname = Form(format, runnumbers[i]);
+    gSystem->ExpandPathName(fname);
+    if(gSystem->AccessPathName(fname)) {
+      dutils::Warning("MakeFrame", __FILE__, __LINE__)
+        << "Skipping run " << runnumbers[i] << ", could not find file " << fname;
+      continue;
+    }
+    files.push_back(fname.Data());
+  }
+  if(files.empty()) {
+    dutils::Error("MakeFrame", __FILE__, __LINE__) << "No files to open";
+    return 0;
+  }
+  return new ROOT::RDataFrame(name, files);
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Create a friend chain
 /// \param chain Initial chain, the one to which we are adding friends.
@@ -225,6 +285,63 @@ void dragon::FriendChain(TChain* chain, const char* friend_name,
   chain->AddFriend(friendchain, friend_alias, kTRUE);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Attach the head and tail trees to a compact coincidence tree
+/// \param t5 Coincidence tree written by `mid2root --compact-coinc`, with a
+///  dragon::CoincLink branch
+/// \param t1 Head singles tree of the same run
+/// \param t3 Tail singles tree of the same run
+/// \returns kTRUE if both trees were attached
+///
+/// The head and tail trees are indexed by event serial number and added as
+/// friends "head" and "tail", so that each coincidence entry reads the singles
+/// events it was made from:
+/// \code
+/// t5->Draw("head.bgo.esort[0]:coinc.xtofh");
+/// \endcode
+/// Building the indices reads the serial numbers of all singles events once.
+Bool_t dragon::FriendCoinc(TTree* t5, TTree* t1, TTree* t3)
+{
+  if(!t5 || !t1 || !t3) {
+    dutils::Error("FriendCoinc", __FILE__, __LINE__) << "Missing tree(s)";
+    return kFALSE;
+  }
+  if(!t5->GetBranch("coinc") || !t5->GetLeaf("head_serial")) {
+    dutils::Error("FriendCoinc", __FILE__, __LINE__)
+      << "Tree \"" << t5->GetName() << "\" is not a compact coincidence tree";
+    return kFALSE;
+  }
+
+  // The index expressions are evaluated in both the singles tree (to build
+  // the index) and the coincidence tree (to look entries up), so give them a
+  // name meaning the serial number in each
+  const char* const names[2] = { "head_serial", "tail_serial" };
+  const char* const aliases[2] = { "head", "tail" };
+  TTree* const singles[2] = { t1, t3 };
+  for(int i=0; i< 2; ++i) {
+    singles[i]->SetAlias(names[i], "header.fSerialNumber");
+    t5->SetAlias(names[i], Form("coinc.%s", names[i]));
+    if(singles[i]->BuildIndex(names[i]) < 0) {
+      dutils::Error("FriendCoinc", __FILE__, __LINE__)
+        << "Failed to index tree \"" << singles[i]->GetName() << "\"";
+      return kFALSE;
+    }
+    t5->AddFriend(singles[i], aliases[i]);
+  }
+
+  return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// FriendCoinc overload, for the "t5", "t1" and "t3" trees of a file
+Bool_t dragon::FriendCoinc(TFile* file)
+{
+  if(!file) return kFALSE;
+  return FriendCoinc(dynamic_cast<TTree*>(file->Get("t5")),
+                     dynamic_cast<TTree*>(file->Get("t1")),
+                     dynamic_cast<TTree*>(file->Get("t3")));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Open a dragon rootfile
 TFile* dragon::OpenRun(int runnum, const char* format)
@@ -815,6 +932,7 @@ TGraph* dragon::RossumData::PlotTransmission(Int_t* runs, Int_t nruns)
 dragon::BeamNorm::BeamNorm():
   fRunDataTree("t_rundata", ""), fRossum(0)
 {
+  SetSbScalerChannels(kSbScaler0, kSbScaler1);
   fRunDataTree.SetMarkerStyle(21);
   fRunDataTree.Branch("rundata", "dragon::BeamNorm::RunData", &fRunDataBranchAddr);
 }
@@ -826,6 +944,7 @@ dragon::BeamNorm::BeamNorm(const char* name, const char* rossumFile):
 {
   SetNameTitle(name, rossumFile);
   ChangeRossumFile(rossumFile);
+  SetSbScalerChannels(kSbScaler0, kSbScaler1);
 
   fRunDataTree.SetMarkerStyle(21);
   fRunDataTree.Branch("rundata", "dragon::BeamNorm::RunData", &fRunDataBranchAddr);
@@ -855,6 +974,11 @@ void dragon::BeamNorm::ChangeRossumFile(const char* name)
 /// \param time Number of seconds at the beginning of the run to use for
 ///  calculating the normalization
 ///
+/// The counts in the peaks need the energy of each event, so they are counted
+/// from the heavy-ion tree. The ungated counts of the detectors' tail scaler
+/// channels (see SetSbScalerChannels()) are read from the tail scaler index,
+/// over the same time window, if the file has one.
+///
 /// \returns The run number of the specified file.
 Int_t dragon::BeamNorm::ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t pkHigh0,
                                      Double_t pkLow1, Double_t pkHigh1,Double_t time)
@@ -905,8 +1029,9 @@ Int_t dragon::BeamNorm::ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t
     return 0;
   }
 
+  dutils::AutoPtr<dragon::EpicsSeries> epicsSeries(static_cast<dragon::EpicsSeries*>(datafile->Get("epicsseries")));
   TTree* t20 = static_cast<TTree*>(datafile->Get("t20"));
-  if(t20 == 0 || t20->GetListOfBranches()->At(0) == 0) {
+  if(epicsSeries.get() == 0 && (t20 == 0 || t20->GetListOfBranches()->At(0) == 0)) {
     dutils::Error("BeamNorm::ReadSbCounts", __FILE__, __LINE__)
       << "no EPICS tree in file" << datafile->GetName();
     return 0;
@@ -916,12 +1041,7 @@ Int_t dragon::BeamNorm::ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t
   dragon::Tail *pTail = &tail;
   t3->SetBranchAddress(t3->GetListOfBranches()->At(0)->GetName(), &pTail);
 
-  dragon::Epics epics;
-  dragon::Epics* pEpics = &epics;
-  t20->SetBranchAddress(t20->GetListOfBranches()->At(0)->GetName(), &pEpics);
-
   AutoResetBranchAddresses Rst3_(t3);
-  AutoResetBranchAddresses Rst20_(t20);
 
   Long64_t ncounts[NSB];
   Long64_t ncounts_full[NSB];
@@ -945,6 +1065,21 @@ Int_t dragon::BeamNorm::ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t
     ncounts[i] = t3->GetPlayer()->GetEntries(cut.str().c_str());
   }
 
+  UDouble_t nscaler[NSB], nscaler_full[NSB];
+  std::fill_n(nscaler, NSB, UDouble_t(0));
+  std::fill_n(nscaler_full, NSB, UDouble_t(0));
+  dutils::AutoPtr<dragon::Scaler::Index> sctIndex(static_cast<dragon::Scaler::Index*>(datafile->Get(dragon::Scaler::index_name("tail"))));
+  if(sctIndex.get()) {
+    //
+    // Two binary searches in the running totals per window
+    const Double_t tbegin = 0, tend = std::numeric_limits<Double_t>::max();
+    for(int i=0; i< NSB; ++i) {
+      if(fSbScaler[i] < 0 || fSbScaler[i] >= dragon::Scaler::MAX_CHANNELS) continue;
+      nscaler[i] = UDouble_t(sctIndex->counts(fSbScaler[i], tstart, tstart + time));
+      nscaler_full[i] = UDouble_t(sctIndex->counts(fSbScaler[i], tbegin, tend));
+    }
+  }
+
   UDouble_t live, live_full[3]; // [3]: head,tail,coinc
   {
     dragon::LiveTimeCalculator ltc;
@@ -957,42 +1092,62 @@ Int_t dragon::BeamNorm::ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t
     live_full[2] = ltc.GetLivetime("coinc");
   }
 
-  t20->GetEntry(0);
-  Double_t tstart20 = pTail->header.fTimeStamp;
-  Int_t t1 = 0;
-  std::vector<double> pressure;
-
-  for(Long64_t entry = 0; entry != t20->GetEntries(); ++entry) {
-    t20->GetEntry(entry);
-    if(pEpics->ch == 0) {
-      pressure.push_back(pEpics->val);
-      if(pEpics->header.fTimeStamp - tstart20 < time)
-        ++t1;
+  Double_t pressureMean = 0, pressureSigma = 0, pressureMeanFull = 0, pressureSigmaFull = 0;
+  if(epicsSeries.get()) {
+    //
+    // Binary search in the channel 0 (pressure) time series
+    // (no readings leaves the pressure at zero)
+    const Double_t tbegin = 0, tend = std::numeric_limits<Double_t>::max();
+    if(epicsSeries->count(0, tbegin, tstart + time)) {
+      pressureMean = epicsSeries->average(0, tbegin, tstart + time);
+      pressureSigma = epicsSeries->stddev(0, tbegin, tstart + time, pressureMean);
+    }
+    if(epicsSeries->size(0)) {
+      pressureMeanFull = epicsSeries->average(0, tbegin, tend);
+      pressureSigmaFull = epicsSeries->stddev(0, tbegin, tend, pressureMeanFull);
     }
   }
+  else {
+    //
+    // Older file, without the time series: scan the EPICS tree
+    dragon::Epics epics;
+    dragon::Epics* pEpics = &epics;
+    t20->SetBranchAddress(t20->GetListOfBranches()->At(0)->GetName(), &pEpics);
+    AutoResetBranchAddresses Rst20_(t20);
+
+    t20->GetEntry(0);
+    Double_t tstart20 = pTail->header.fTimeStamp;
+    Int_t t1 = 0;
+    std::vector<double> pressure;
+
+    for(Long64_t entry = 0; entry != t20->GetEntries(); ++entry) {
+      t20->GetEntry(entry);
+      if(pEpics->ch == 0) {
+        pressure.push_back(pEpics->val);
+        if(pEpics->header.fTimeStamp - tstart20 < time)
+          ++t1;
+      }
+    }
+    pressureMean = utils::calculate_mean(pressure.begin(), pressure.begin() + t1);
+    pressureSigma = utils::calculate_stddev(pressure.begin(), pressure.begin() + t1, pressureMean);
+    pressureMeanFull = utils::calculate_mean(pressure.begin(), pressure.end());
+    pressureSigmaFull = utils::calculate_stddev(pressure.begin(), pressure.end(), pressureMeanFull);
+  }
 
   RunData* rundata = GetOrCreateRunData(runnum);
   rundata->time = time;
   for(int i=0; i< NSB; ++i) {
     rundata->sb_counts[i] = UDouble_t(ncounts[i]);
     rundata->sb_counts_full[i] = UDouble_t(ncounts_full[i]);
+    rundata->sb_scaler[i] = nscaler[i];
+    rundata->sb_scaler_full[i] = nscaler_full[i];
   }
   //
   // Pressure over SB norm time
-  {
-    const Double_t pressureMean = utils::calculate_mean(pressure.begin(), pressure.begin() + t1);
-    const Double_t pressureSigma = utils::calculate_stddev(pressure.begin(),
-                                                           pressure.begin() + t1, pressureMean);
-    rundata->pressure = UDouble_t (pressureMean, pressureSigma);
-  }
+  rundata->pressure = UDouble_t (pressureMean, pressureSigma);
   //
   // Pressure over full run
-  {
-    const Double_t pressureMean = utils::calculate_mean(pressure.begin(), pressure.end());
-    const Double_t pressureSigma = utils::calculate_stddev(pressure.begin(),
-                                                           pressure.end(), pressureMean);
-    rundata->pressure_full = UDouble_t (pressureMean, pressureSigma);
-  }
+  rundata->pressure_full = UDouble_t (pressureMeanFull, pressureSigmaFull);
   rundata->live_time = live;
   rundata->live_time_head  = live_full[0];
   rundata->live_time_tail  = live_full[1];
@@ -1017,6 +1172,41 @@ void dragon::BeamNorm::ReadFC4(Int_t runnum, Double_t skipBegin, Double_t skipEn
   rundata->fc1 = fRossum->AverageCurrent(runnum, 1, 0, skipBegin, skipEnd);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Read the number of counts in a scaler channel over part of a run
+/// \param datafile Pointer to the run's ROOT file
+/// \param which Which scaler: "head", "tail" or "aux"
+/// \param ch Scaler channel
+/// \param t0 Start of the window, in seconds after the first scaler read
+/// \param t1 End of the window, in seconds after the first scaler read
+///
+/// \returns Sum of the channel's counts over the reads in `[t0, t1)`, with
+///  Poisson uncertainty. Uses the scaler index written by mid2root, so the cost
+///  does not depend on the length of the run.
+UDouble_t dragon::BeamNorm::ReadScalerCounts(TFile* datafile, const char* which, Int_t ch,
+                                             Double_t t0, Double_t t1)
+{
+  if(!datafile || datafile->IsZombie()) {
+    dutils::Error("BeamNorm::ReadScalerCounts", __FILE__, __LINE__)
+      << "Invalid datafile: " << datafile;
+    return UDouble_t(0);
+  }
+  const char* name = dragon::Scaler::index_name(which);
+  if(!name) {
+    dutils::Error("BeamNorm::ReadScalerCounts", __FILE__, __LINE__)
+      << "Invalid scaler \"" << which << "\", valid options are \"head\", \"tail\" or \"aux\"";
+    return UDouble_t(0);
+  }
+  dutils::AutoPtr<dragon::Scaler::Index> index(static_cast<dragon::Scaler::Index*>(datafile->Get(name)));
+  if(index.get() == 0) {
+    dutils::Error("BeamNorm::ReadScalerCounts", __FILE__, __LINE__)
+      << "no scaler index \"" << name << "\" in file " << datafile->GetName();
+    return UDouble_t(0);
+  }
+  const Double_t tbegin = index->begin_time();
+  return UDouble_t(index->counts(ch, tbegin + t0, tbegin + t1));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Calculate R and total beam particles
 void dragon::BeamNorm::CalculateNorm(Int_t run, Int_t chargeState)
@@ -1175,6 +1365,14 @@ TGraphErrors* dragon::BeamNorm::PlotVal(const TString& valstr, int which, Marker
       val.push_back(rd->sb_counts_full[which].GetNominal());
       err.push_back(rd->sb_counts_full[which].GetErrLow());
     }
+    else if(valstr == "sb_scaler") {
+      val.push_back(rd->sb_scaler[which].GetNominal());
+      err.push_back(rd->sb_scaler[which].GetErrLow());
+    }
+    else if(valstr == "sb_scaler_full") {
+      val.push_back(rd->sb_scaler_full[which].GetNominal());
+      err.push_back(rd->sb_scaler_full[which].GetErrLow());
+    }
     else if(valstr == "live_time") {
       val.push_back(rd->live_time.GetNominal());
       err.push_back(rd->live_time.GetErrLow());
@@ -22,6 +22,7 @@
 #include <TTree.h>
 #include <TString.h>
 #include <TSelector.h>
+#include <RVersion.h>
 
 #include "midas/libMidasInterface/TMidasStructs.h"
 #include "Uncertainty.hxx"
@@ -34,6 +35,12 @@ class TGraph;
 class TGraphErrors;
 class TGraphAsymmErrors;
 
+/// RDataFrame is available (ROOT 6.14 and later)
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+#define DRAGON_HAVE_RDATAFRAME
+namespace ROOT { class RDataFrame; }
+#endif
+
 namespace dragon {
 
   enum MeasurementType_t {
@@ -54,11 +61,22 @@ namespace dragon {
   /// Chain together trees using a vector instead of array
   void MakeChains(const char* prefix, const std::vector<Int_t>& runnumbers, const char* format = "$DH/rootfiles/run%d.root", Bool_t sonik = kFALSE);
 
+#ifdef DRAGON_HAVE_RDATAFRAME
+  /// Open one tree or RNTuple of multiple DRAGON files as an RDataFrame
+  ROOT::RDataFrame* MakeFrame(const char* name, const std::vector<Int_t>& runnumbers, const char* format = "$DH/rootfiles/run%d.root");
+#endif
+
   /// Add another chain of files as a friend to an existing one
   void FriendChain(TChain* chain, const char* friend_name, const char* friend_alias,
                    const char* format = "$DH/rootfiles/run%d.root",
                    const char* friend_format = "$DH/rootfiles/run%d_dsssd_recal.root");
 
+  /// Attach the head and tail trees to a compact coincidence tree
+  Bool_t FriendCoinc(TTree* t5, TTree* t1, TTree* t3);
+
+  /// Attach the head and tail trees of a file to its compact coincidence tree
+  Bool_t FriendCoinc(TFile* file);
+
   /// Open a file just by run number
   TFile* OpenRun(int runnum, const char* format = "$DH/rootfiles/run%d.root");
 
@@ -304,6 +322,10 @@ namespace dragon {
       UDouble_t sb_counts[dragon::SurfaceBarrier::MAX_CHANNELS]; // sb counts for norm period
       /// Number of sb counts in the whole run
       UDouble_t sb_counts_full[dragon::SurfaceBarrier::MAX_CHANNELS]; // sb counts whole run
+      /// Ungated sb scaler counts in _time_, per detector (see SetSbScalerChannels())
+      UDouble_t sb_scaler[dragon::SurfaceBarrier::MAX_CHANNELS]; // sb scaler counts for norm period
+      /// Ungated sb scaler counts in the whole run
+      UDouble_t sb_scaler_full[dragon::SurfaceBarrier::MAX_CHANNELS]; // sb scaler counts whole run
       /// Live time in _time_ used for SB normalization
       UDouble_t live_time; // live time in norm period
       /// Tail live time across the whole run
@@ -335,6 +357,8 @@ namespace dragon {
       {
         std::fill_n(sb_counts,      dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
         std::fill_n(sb_counts_full, dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
+        std::fill_n(sb_scaler,      dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
+        std::fill_n(sb_scaler_full, dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
         std::fill_n(sbnorm,         dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
         std::fill_n(nbeam,          dragon::SurfaceBarrier::MAX_CHANNELS, UDouble_t(0));
         std::fill_n(fc4, 3, UDouble_t(0));
@@ -367,6 +391,8 @@ namespace dragon {
 	Int_t ReadSbCounts(TFile* datafile, Double_t pkLow0, Double_t pkHigh0,
                        Double_t pkLow1, Double_t pkHigh1,Double_t time = 120.);
 	void ReadFC4(Int_t runnum, Double_t skipBegin = 10, Double_t skipEnd = 5);
+	UDouble_t ReadScalerCounts(TFile* datafile, const char* which, Int_t ch,
+                               Double_t t0 = 0, Double_t t1 = 1e30);
 	void CalculateNorm(Int_t run, Int_t chargeState);
 	RunData* GetRunData(Int_t runnum);
 	std::vector<Int_t>& GetRuns() const;
@@ -384,6 +410,8 @@ namespace dragon {
     }
 	void SetEfficiency(const char* name, UDouble_t value) { fEfficiencies[name] = value; }
 	void SetEfficiency(const char* name, Double_t value)  { fEfficiencies[name] = UDouble_t(value, 0); }
+	/// Set the tail scaler channels counting each sb detector, -1 for none (default: 10 and none)
+	void SetSbScalerChannels(Int_t ch0, Int_t ch1) { fSbScaler[0] = ch0; fSbScaler[1] = ch1; }
 	void CorrectTransmission(Int_t reference);
 	UDouble_t CalculateEfficiency(Bool_t print = kTRUE);
 	UDouble_t CalculateYield(Int_t whichSb, Int_t type = kHiSingles, Bool_t print = kTRUE); // type: 1 = gamma sing., 3 = hi sing. 5 = coinc.
@@ -403,8 +431,9 @@ namespace dragon {
 	std::map<Int_t, RunData> fRunData;
 	dragon::utils::AutoPtr<RossumData> fRossum;
 	std::map<std::string, UDouble_t> fEfficiencies;
+	Int_t fSbScaler[dragon::SurfaceBarrier::MAX_CHANNELS];
 
-	ClassDef(BeamNorm, 2);
+	ClassDef(BeamNorm, 3);
   };
 
 
@@ -3,8 +3,11 @@
 /// \brief Implements selector classes
 ///
 #include "midas/Database.hxx"
+#include "Batch.hxx"
 #include "Selectors.hxx"
 
+namespace { const Int_t kDsssdBlockSize = 1024; }
+
 
 void dragon::ASelector::Begin(TTree*)
 {
@@ -417,6 +420,10 @@ void dragon::DsssdCalibrate::InitMembers()
 	fChain5 = 0;
 	fDsssd3 = new dragon::Dsssd();
 	fDsssd5 = new dragon::Dsssd();
+	fBlock3 = new dragon::batch::DsssdBlock(kDsssdBlockSize);
+	fBlock5 = new dragon::batch::DsssdBlock(kDsssdBlockSize);
+	fNumBlock3 = 0;
+	fNumBlock5 = 0;
 }
 
 void dragon::DsssdCalibrate::Init(TTree *tree)
@@ -445,13 +452,30 @@ void dragon::DsssdCalibrate::Begin(TTree*)
 }
 
 
-void dragon::DsssdCalibrate::ProcessEntry(TTree* tout, Dsssd* dsssd, vme::V792* adc)
+void dragon::DsssdCalibrate::ProcessEntry(TTree* tout, Dsssd* dsssd, batch::DsssdBlock* block, Int_t& nblock,
+																					vme::V792* adc)
 {
+	/// Reads the raw data into the next event of \e block, calculates the block once it is full
 	vme::V1190 tdc; // dummy
 
 	dsssd->read_data(adc, tdc);
-	dsssd->calculate();
-	tout->Fill();
+	block->load(nblock++, *dsssd);
+	if(nblock == block->size())
+		FlushBlock(tout, dsssd, block, nblock);
+}
+
+void dragon::DsssdCalibrate::FlushBlock(TTree* tout, Dsssd* dsssd, batch::DsssdBlock* block, Int_t& nblock)
+{
+	/// Same results as calling Dsssd::calculate() and filling for each event (see test/batchtest.cxx)
+	if(nblock == 0 || tout == 0) return;
+
+	block->variables = dsssd->variables;
+	block->calculate();
+	for(Int_t i=0; i< nblock; ++i) {
+		block->store(i, *dsssd);
+		tout->Fill();
+	}
+	nblock = 0;
 }
 
 Bool_t dragon::DsssdCalibrate::Process(Long64_t entry)
@@ -467,11 +491,11 @@ Bool_t dragon::DsssdCalibrate::Process(Long64_t entry)
 					"fDsssd3 == 0 || fDsssd5 == 0");
 
 	fAdcBranch3->GetEntry(entry);
-	ProcessEntry(fT3, fDsssd3, fAdc3);
+	ProcessEntry(fT3, fDsssd3, fBlock3, fNumBlock3, fAdc3);
 
 	if(entry < fChain5->GetEntries()) {
 		fAdcBranch5->GetEntry(entry);
-		ProcessEntry(fT5, fDsssd5, fAdc5);
+		ProcessEntry(fT5, fDsssd5, fBlock5, fNumBlock5, fAdc5);
 	}
 
 	return kTRUE;
@@ -485,6 +509,8 @@ Bool_t dragon::DsssdCalibrate::Notify()
 		Abort("!fDsssd3 || !fDsssd5");
 
 	if(fT3 && fT5 && fOut) {
+		FlushBlock(fT3, fDsssd3, fBlock3, fNumBlock3);
+		FlushBlock(fT5, fDsssd5, fBlock5, fNumBlock5);
 		fT3->AutoSave();
 		fT5->AutoSave();
 		fT3->ResetBranchAddresses();
@@ -519,6 +545,8 @@ void dragon::DsssdCalibrate::Terminate()
 	/// Close open files, save trees, etc.
 	///
 	if(fOut && fT3 && fT5) {
+		FlushBlock(fT3, fDsssd3, fBlock3, fNumBlock3);
+		FlushBlock(fT5, fDsssd5, fBlock5, fNumBlock5);
 		fT3->AutoSave();
 		fT3->ResetBranchAddresses();
 		fT5->AutoSave();
@@ -544,4 +572,8 @@ dragon::DsssdCalibrate::~DsssdCalibrate()
 		delete fDsssd5;
 		fDsssd5 = 0;
 	}
+	delete fBlock3;
+	delete fBlock5;
+	fBlock3 = 0;
+	fBlock5 = 0;
 }
@@ -21,6 +21,7 @@
 
 
 namespace midas { class Database; }
+namespace dragon { namespace batch { class DsssdBlock; } }
 
 
 namespace dragon {
@@ -640,6 +641,15 @@ public:
 	/// Input ADC branch (coinc)
 	TBranch* fAdcBranch5; //!
 
+	/// Events waiting to be calculated (singles)
+	batch::DsssdBlock* fBlock3; //!
+	/// Events waiting to be calculated (coinc)
+	batch::DsssdBlock* fBlock5; //!
+	/// Number of events in fBlock3
+	Int_t fNumBlock3; //!
+	/// Number of events in fBlock5
+	Int_t fNumBlock5; //!
+
 public:
 	/// Construct from slope and offset array
 	DsssdCalibrate(Double_t* slopes, Double_t* offsets);
@@ -664,7 +674,9 @@ private:
 	/// Constructor helper
 	void InitMembers();
 	/// Process() helper
-	void ProcessEntry(TTree* tout, Dsssd* dsssd, vme::V792* adc);
+	void ProcessEntry(TTree* tout, Dsssd* dsssd, batch::DsssdBlock* block, Int_t& nblock, vme::V792* adc);
+	/// Calculate the events of a block and fill them into an output tree
+	void FlushBlock(TTree* tout, Dsssd* dsssd, batch::DsssdBlock* block, Int_t& nblock);
 };
 
 } // namespace dragon
@@ -0,0 +1,53 @@
+///
+/// \file VarInt.hxx
+/// \author G. Christian
+/// \brief Defines variable-length integer encoding for compact on-disk indices
+///
+#ifndef DRAGON_UTILS_VAR_INT_HXX
+#define DRAGON_UTILS_VAR_INT_HXX
+#include <vector>
+#include "utils/IntTypes.h"
+
+namespace dragon { namespace utils {
+
+/// Append an unsigned integer as little-endian base-128 digits
+/*!
+ * Seven bits per byte, the high bit set on all but the last byte: values
+ * under 128 take one byte, under 16384 two, and so on. Meant for storing
+ * small differences (e.g. between consecutive timestamps) in few bytes.
+ */
+inline void put_varint(std::vector<uint8_t>& codes, uint64_t value)
+{
+	while(value >= 0x80) {
+		codes.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	codes.push_back(static_cast<uint8_t>(value));
+}
+
+/// Read an unsigned integer written by put_varint()
+/*!
+ * \param codes Encoded data
+ * \param [in,out] pos Position in `codes`, advanced past the value
+ * \param [out] value Decoded value
+ * \returns false if `codes` ends in the middle of a value
+ */
+template <class T>
+inline bool get_varint(const std::vector<uint8_t>& codes, size_t& pos, T& value)
+{
+	uint64_t result = 0;
+	for(int shift = 0; pos < codes.size() && shift < 64; shift += 7) {
+		const uint8_t byte = codes[pos++];
+		result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if((byte & 0x80) == 0) {
+			value = static_cast<T>(result);
+			return true;
+		}
+	}
+	return false;
+}
+
+} } // namespace dragon namespace utils
+
+
+#endif
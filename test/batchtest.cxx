@@ -0,0 +1,224 @@
+//
+// Test of the structure-of-arrays batch calculations in Batch.hxx: checks that
+// calculate() on a block of randomized events gives exactly the results of the
+// scalar calculate() on each event, for the BGO, DSSSD, ion chamber and MCP.
+// Raw values include NoData, negative values and values below the BGO zero
+// suppression threshold; calibrations and the BGO sort depth are randomized.
+//
+// Build with `make batchtest`, run as `bin/batchtest [nevents] [seed]`
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "utils/Valid.hxx"
+#include "Dragon.hxx"
+#include "Batch.hxx"
+
+namespace {
+
+int gFailures = 0;
+
+/// Raw ADC/TDC value: NoData, negative, small (below threshold) or typical
+double raw_value()
+{
+	switch(rand() % 10) {
+	case 0:  return dragon::NoData<double>::value();
+	case 1:  return -(rand() % 100);
+	case 2:  return rand() % 20;
+	default: return rand() % 4096;
+	}
+}
+
+void randomize(double* x, int n)
+{
+	for(int i=0; i< n; ++i) x[i] = raw_value();
+}
+
+double uniform(double lo, double hi)
+{
+	return lo + (hi - lo) * (rand() / (RAND_MAX + 1.));
+}
+
+template <int N>
+void randomize(dragon::utils::AdcVariables<N>& adc)
+{
+	for(int i=0; i< N; ++i) {
+		adc.pedestal[i] = rand() % 50;
+		adc.offset[i]   = uniform(-10., 10.);
+		adc.slope[i]    = uniform(0., 2.);
+	}
+}
+
+template <int N>
+void randomize(dragon::utils::TdcVariables<N>& tdc)
+{
+	for(int i=0; i< N; ++i) {
+		tdc.offset[i] = uniform(-100., 100.);
+		tdc.slope[i]  = uniform(0., 1.);
+	}
+}
+
+void randomize(dragon::utils::AdcVariables<1>& adc)
+{
+	adc.pedestal = rand() % 50;
+	adc.offset   = uniform(-10., 10.);
+	adc.slope    = uniform(0., 2.);
+}
+
+void randomize(dragon::utils::TdcVariables<1>& tdc)
+{
+	tdc.offset = uniform(-100., 100.);
+	tdc.slope  = uniform(0., 1.);
+}
+
+/// Bitwise comparison, so NoData and signed zeros must match exactly
+template <class T>
+void compare(const char* what, int evt, const T* scalar, const T* batch, int n = 1)
+{
+	if(memcmp(scalar, batch, n*sizeof(T)) == 0) return;
+	if(gFailures++ < 20)
+		printf("  %s differs in event %d\n", what, evt);
+}
+
+void compare_results(const dragon::Bgo& s, const dragon::Bgo& b, int evt)
+{
+	compare("bgo.ecal", evt, s.ecal, b.ecal, dragon::Bgo::MAX_CHANNELS);
+	compare("bgo.tcal", evt, s.tcal, b.tcal, dragon::Bgo::MAX_CHANNELS);
+	compare("bgo.esort", evt, s.esort, b.esort, dragon::Bgo::MAX_CHANNELS);
+	compare("bgo.sum", evt, &s.sum, &b.sum);
+	compare("bgo.hit0", evt, &s.hit0, &b.hit0);
+	compare("bgo.x0", evt, &s.x0, &b.x0);
+	compare("bgo.y0", evt, &s.y0, &b.y0);
+	compare("bgo.z0", evt, &s.z0, &b.z0);
+	compare("bgo.t0", evt, &s.t0, &b.t0);
+}
+
+void compare_results(const dragon::Dsssd& s, const dragon::Dsssd& b, int evt)
+{
+	compare("dsssd.ecal", evt, s.ecal, b.ecal, dragon::Dsssd::MAX_CHANNELS);
+	compare("dsssd.efront", evt, &s.efront, &b.efront);
+	compare("dsssd.eback", evt, &s.eback, &b.eback);
+	compare("dsssd.hit_front", evt, &s.hit_front, &b.hit_front);
+	compare("dsssd.hit_back", evt, &s.hit_back, &b.hit_back);
+	compare("dsssd.tfront", evt, &s.tfront, &b.tfront);
+	compare("dsssd.tback", evt, &s.tback, &b.tback);
+}
+
+void compare_results(const dragon::IonChamber& s, const dragon::IonChamber& b, int evt)
+{
+	compare("ic.anode", evt, s.anode, b.anode, dragon::IonChamber::MAX_CHANNELS);
+	compare("ic.tcal", evt, s.tcal, b.tcal, dragon::IonChamber::MAX_TDC);
+	compare("ic.sum", evt, &s.sum, &b.sum);
+}
+
+void compare_results(const dragon::Mcp& s, const dragon::Mcp& b, int evt)
+{
+	compare("mcp.anode", evt, s.anode, b.anode, dragon::Mcp::MAX_CHANNELS);
+	compare("mcp.tcal", evt, s.tcal, b.tcal, dragon::Mcp::NUM_DETECTORS);
+	compare("mcp.esum", evt, &s.esum, &b.esum);
+	compare("mcp.tac", evt, &s.tac, &b.tac);
+	compare("mcp.x", evt, &s.x, &b.x);
+	compare("mcp.y", evt, &s.y, &b.y);
+}
+
+struct RandomBgo {
+	void variables(dragon::Bgo::Variables& v) const
+		{
+			randomize(v.adc);
+			randomize(v.tdc);
+			v.nsort = 1 + rand() % dragon::Bgo::MAX_CHANNELS;
+		}
+	void event(dragon::Bgo& bgo) const
+		{
+			randomize(bgo.ecal, dragon::Bgo::MAX_CHANNELS);
+			randomize(bgo.tcal, dragon::Bgo::MAX_CHANNELS);
+		}
+};
+
+struct RandomDsssd {
+	void variables(dragon::Dsssd::Variables& v) const
+		{
+			randomize(v.adc);
+			randomize(v.tdc_front);
+			randomize(v.tdc_back);
+		}
+	void event(dragon::Dsssd& dsssd) const
+		{
+			randomize(dsssd.ecal, dragon::Dsssd::MAX_CHANNELS);
+			dsssd.tfront = raw_value();
+			dsssd.tback  = raw_value();
+		}
+};
+
+struct RandomIonChamber {
+	void variables(dragon::IonChamber::Variables& v) const
+		{
+			randomize(v.adc);
+			randomize(v.tdc);
+		}
+	void event(dragon::IonChamber& ic) const
+		{
+			randomize(ic.anode, dragon::IonChamber::MAX_CHANNELS);
+			randomize(ic.tcal, dragon::IonChamber::MAX_TDC);
+		}
+};
+
+struct RandomMcp {
+	void variables(dragon::Mcp::Variables& v) const
+		{
+			randomize(v.adc);
+			randomize(v.tdc);
+			randomize(v.tac_adc);
+		}
+	void event(dragon::Mcp& mcp) const
+		{
+			randomize(mcp.anode, dragon::Mcp::MAX_CHANNELS);
+			randomize(mcp.tcal, dragon::Mcp::NUM_DETECTORS);
+			mcp.tac = raw_value();
+		}
+};
+
+/// Run `nevt` events of detector `D` through both versions, with randomized variables
+template <class D, class B, class R>
+void run(const char* name, int nevt, R random)
+{
+	B block(nevt);
+	random.variables(block.variables);
+	std::vector<D> scalar(nevt);
+
+	for(int evt = 0; evt < nevt; ++evt) {
+		scalar[evt].variables = block.variables;
+		random.event(scalar[evt]);
+		block.load(evt, scalar[evt]);
+		scalar[evt].calculate();
+	}
+	block.calculate();
+
+	const int failures = gFailures;
+	for(int evt = 0; evt < nevt; ++evt) {
+		D batch;
+		block.store(evt, batch);
+		compare_results(scalar[evt], batch, evt);
+	}
+	printf("%-6s %d events: %s\n", name, nevt, gFailures == failures ? "OK" : "FAILED");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const int nevt = argc > 1 ? atoi(argv[1]) : 1000;
+	srand(argc > 2 ? atoi(argv[2]) : 1);
+
+	run<dragon::Bgo, dragon::batch::BgoBlock>("bgo", nevt, RandomBgo());
+	run<dragon::Dsssd, dragon::batch::DsssdBlock>("dsssd", nevt, RandomDsssd());
+	run<dragon::IonChamber, dragon::batch::IonChamberBlock>("ic", nevt, RandomIonChamber());
+	run<dragon::Mcp, dragon::batch::McpBlock>("mcp", nevt, RandomMcp());
+
+	if(gFailures) {
+		printf("%d differences\n", gFailures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+//
+// Microbenchmark: generic vs. fixed-size (masked) calibration kernels
+// in utils/Functions.hxx, for the BGO (30 channel) and DSSSD (32 channel)
+// array sizes. Checks that both give identical results.
+//
+// Build with `make calbench`, run as `bin/calbench [nloops]`
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "utils/Functions.hxx"
+
+namespace dutils = dragon::utils;
+
+// Deriving from the variables structs means the fixed-size overloads need
+// a derived-to-base conversion, so calls with these types resolve to the
+// generic array versions.
+template <int N> struct GenericAdc: public dutils::AdcVariables<N> { };
+template <int N> struct GenericTdc: public dutils::TdcVariables<N> { };
+
+const int NEVENTS = 1024;
+
+template <int N>
+struct Bench {
+	GenericAdc<N> adc;
+	GenericTdc<N> tdc;
+	std::vector<double> raw, e1, e2, t1, t2;
+
+	Bench(): raw(NEVENTS*N), e1(NEVENTS*N), e2(NEVENTS*N), t1(NEVENTS*N), t2(NEVENTS*N)
+		{
+			for(int i=0; i< N; ++i) {
+				adc.pedestal[i] = rand() % 50;
+				adc.offset[i]   = -5. + i*0.1;
+				adc.slope[i]    = 0.5 + i*0.01;
+				tdc.offset[i]   = 100. - i;
+				tdc.slope[i]    = 0.1;
+			}
+			for(size_t i=0; i< raw.size(); ++i) {
+				raw[i] = rand() % 4 ? rand() % 4096 : dragon::NoData<double>::value();
+			}
+		}
+
+	void generic(double* e, double* t)
+		{
+			for(int evt = 0; evt < NEVENTS; ++evt) {
+				dutils::pedestal_subtract(e + evt*N, N, adc);
+				dutils::zero_suppress1(e + evt*N, N, 10.);
+				dutils::linear_calibrate(e + evt*N, N, adc);
+				dutils::linear_calibrate(t + evt*N, N, tdc);
+			}
+		}
+
+	void masked(double* e, double* t)
+		{
+			const dutils::AdcVariables<N>& a = adc;
+			const dutils::TdcVariables<N>& d = tdc;
+			for(int evt = 0; evt < NEVENTS; ++evt) {
+				dutils::pedestal_subtract(e + evt*N, N, a);
+				dutils::zero_suppress1<N>(e + evt*N, 10.);
+				dutils::linear_calibrate(e + evt*N, N, a);
+				dutils::linear_calibrate(t + evt*N, N, d);
+			}
+		}
+
+	double time(bool useMasked, int nloops)
+		{
+			std::clock_t total = 0;
+			for(int i=0; i< nloops; ++i) {
+				double* e = useMasked ? &e2[0] : &e1[0];
+				double* t = useMasked ? &t2[0] : &t1[0];
+				std::copy(raw.begin(), raw.end(), e);
+				std::copy(raw.begin(), raw.end(), t);
+				std::clock_t begin = std::clock();
+				if(useMasked) masked(e, t);
+				else          generic(e, t);
+				total += std::clock() - begin;
+			}
+			return 1e9 * total / CLOCKS_PER_SEC / ((double)nloops * NEVENTS);
+		}
+
+	bool run(const char* name, int nloops)
+		{
+			double tg = time(false, nloops);
+			double tm = time(true, nloops);
+			bool same =
+				!memcmp(&e1[0], &e2[0], e1.size()*sizeof(double)) &&
+				!memcmp(&t1[0], &t2[0], t1.size()*sizeof(double));
+			printf("%-8s N = %2d: generic %7.1f ns/event, masked %7.1f ns/event, speedup %4.2f, results %s\n",
+						 name, N, tg, tm, tg/tm, same ? "identical" : "DIFFER");
+			return same;
+		}
+};
+
+int main(int argc, char** argv)
+{
+	int nloops = argc > 1 ? atoi(argv[1]) : 2000;
+
+	Bench<30> bgo;
+	Bench<32> dsssd;
+	bool same = true;
+	same = bgo.run("BGO", nloops) && same;
+	same = dsssd.run("DSSSD", nloops) && same;
+
+	return same ? 0 : 1;
+}
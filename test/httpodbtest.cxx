@@ -0,0 +1,283 @@
+//
+// Test of HttpOdb against a small stand-in for mhttpd, run in a child
+// process on a local port. Checks values read, keep-alive connections,
+// batched ("odb0=...&odb1=...") requests, caching, odbInvalidate() and
+// falling back to the default values on HTTP errors.
+//
+// Build with `make httpodbtest`, run as `bin/httpodbtest`
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "midas/libMidasInterface/HttpOdb.h"
+
+namespace {
+
+// ODB of the stand-in server: arrays of values, by path
+std::map<std::string, std::vector<std::string> > gOdb;
+
+void fill_odb(int runNumber)
+{
+	gOdb.clear();
+	std::ostringstream run;
+	run << runNumber;
+	gOdb["/Runinfo/Run number"].push_back(run.str());
+	gOdb["/Experiment/Name"].push_back("dragon");
+	gOdb["/Experiment/Run Parameters/Comment"].push_back("beam on target");
+	gOdb["/dragon/bgo/enabled"].push_back("y");
+	for(int i=0; i< 30; ++i) {
+		std::ostringstream val;
+		val << 0.5 + i;
+		gOdb["/dragon/bgo/variables/adc/slope"].push_back(val.str());
+	}
+}
+
+std::string url_decode(const std::string& s)
+{
+	std::string out;
+	for(size_t i=0; i< s.size(); ++i) {
+		if(s[i] == '%' && i+2 < s.size()) {
+			out += (char)strtol(s.substr(i+1, 2).c_str(), 0, 16);
+			i += 2;
+		}
+		else out += (s[i] == '+' ? ' ' : s[i]);
+	}
+	return out;
+}
+
+// Value of "path[index]", as mhttpd's jget
+std::string jget(const std::string& item)
+{
+	size_t bracket = item.rfind('[');
+	std::string path = item.substr(0, bracket);
+	int index = bracket == std::string::npos ? 0 : atoi(item.c_str() + bracket + 1);
+	if(!gOdb.count(path)) return "<DB_NO_KEY>";
+	if(index < 0 || index >= (int)gOdb[path].size()) return "<DB_OUT_OF_RANGE>";
+	return gOdb[path][index];
+}
+
+// Reply to the query part of a request
+std::string answer(const std::string& query)
+{
+	if(query.compare(0, 8, "cmd=bump") == 0) { // change the ODB, as at a run transition
+		fill_odb(atoi(gOdb["/Runinfo/Run number"][0].c_str()) + 1);
+		return "OK";
+	}
+
+	std::map<std::string, std::string> param;
+	std::vector<std::string> items;
+	std::istringstream strm(query);
+	std::string p;
+	while(std::getline(strm, p, '&')) {
+		size_t eq = p.find('=');
+		std::string key = p.substr(0, eq), value = url_decode(p.substr(eq+1));
+		param[key] = value;
+		if(key.compare(0, 3, "odb") == 0 && key.size() > 3)
+			items.push_back(value);
+	}
+
+	if(param["cmd"] == "jkey") {
+		const std::string& path = param["odb"];
+		if(!gOdb.count(path)) return "<DB_NO_KEY>";
+		std::ostringstream reply;
+		reply << path.substr(path.rfind('/')+1) << "\n9\n" << gOdb[path].size() << "\n32\n";
+		return reply.str();
+	}
+	if(param["cmd"] == "jget") {
+		if(param.count("odb")) return jget(param["odb"]);
+		std::string reply;
+		for(size_t i=0; i< items.size(); ++i)
+			reply += (i ? "$#----#$\n" : "") + jget(items[i]);
+		return reply;
+	}
+	return "<unknown>";
+}
+
+// Reply to the complete requests in a connection's input; false once the connection is to be closed
+bool reply_all(int sock, std::string& in, int& nreq)
+{
+	size_t end;
+	while((end = in.find("\r\n\r\n")) != std::string::npos) {
+		std::string request = in.substr(0, end);
+		in.erase(0, end + 4);
+		size_t q = request.find('?'), sp = request.find(' ', q);
+		bool found = request.substr(0, q).find("/secret.html") != std::string::npos;
+		std::string body = found ? answer(request.substr(q+1, sp-q-1)) : "Not found";
+		std::ostringstream reply;
+		reply << (found ? "HTTP/1.1 200 OK" : "HTTP/1.1 404 Not Found")
+					<< "\r\nContent-Type: text/plain\r\n"
+					<< "Content-Length: " << body.size() << "\r\n";
+		if(++nreq == 50) reply << "Connection: close\r\n";
+		reply << "\r\n" << body;
+		send(sock, reply.str().data(), reply.str().size(), 0);
+		if(nreq == 50) return false;
+	}
+	return true;
+}
+
+// Serve keep-alive connections until killed; closes each after 50 requests
+void serve(int listener)
+{
+	fill_odb(100);
+	std::map<int, std::string> input;
+	std::map<int, int> nreq;
+	while(1) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(listener, &fds);
+		int maxfd = listener;
+		for(std::map<int, std::string>::iterator it = input.begin(); it != input.end(); ++it) {
+			FD_SET(it->first, &fds);
+			if(it->first > maxfd) maxfd = it->first;
+		}
+		if(select(maxfd+1, &fds, 0, 0, 0) < 0) continue;
+
+		std::vector<int> closed;
+		for(std::map<int, std::string>::iterator it = input.begin(); it != input.end(); ++it) {
+			if(!FD_ISSET(it->first, &fds)) continue;
+			char buf[4096];
+			ssize_t rd = recv(it->first, buf, sizeof(buf), 0);
+			if(rd > 0) it->second.append(buf, rd);
+			if(rd <= 0 || !reply_all(it->first, it->second, nreq[it->first]))
+				closed.push_back(it->first);
+		}
+		for(size_t i=0; i< closed.size(); ++i) {
+			close(closed[i]);
+			input.erase(closed[i]);
+			nreq.erase(closed[i]);
+		}
+		if(FD_ISSET(listener, &fds)) {
+			int sock = accept(listener, 0, 0);
+			if(sock >= 0) { input[sock] = ""; nreq[sock] = 0; }
+		}
+	}
+}
+
+int gFailures = 0;
+
+void check(bool ok, const char* what)
+{
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if(!ok) ++gFailures;
+}
+
+} // namespace
+
+int main()
+{
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t len = sizeof(addr);
+	if(bind(listener, (struct sockaddr*)&addr, sizeof(addr)) || listen(listener, 4) ||
+		 getsockname(listener, (struct sockaddr*)&addr, &len)) {
+		perror("httpodbtest: cannot open a local port");
+		return 1;
+	}
+
+	pid_t server = fork();
+	if(server == 0) {
+		serve(listener);
+		_exit(0);
+	}
+	close(listener);
+
+	char url[256];
+	snprintf(url, sizeof(url), "http://127.0.0.1:%d/CS/secret.html", ntohs(addr.sin_port));
+	HttpOdb odb(url);
+
+	check(odb.odbReadInt("/Runinfo/Run number", 0, -1) == 100, "read int");
+	check(!strcmp(odb.odbReadString("/Experiment/Run Parameters/Comment", 0, ""), "beam on target"),
+				"read string with spaces");
+	check(odb.odbReadBool("/dragon/bgo/enabled", 0, false), "read bool");
+	check(odb.odbReadInt("/does/not/exist", 0, -1) == -1, "missing key gives default");
+	check(odb.odbReadArraySize("/dragon/bgo/variables/adc/slope") == 30, "array size");
+
+	// one jkey and one jget for the whole array, then everything from the cache
+	int requests = odb.GetNumRequests();
+	bool same = true;
+	for(int i=0; i< 30; ++i)
+		same = same && odb.odbReadDouble("/dragon/bgo/variables/adc/slope", i, -1) == 0.5 + i;
+	check(same, "array values");
+	check(odb.GetNumRequests() - requests == 1, "array read in a single request");
+	check(odb.odbReadDouble("/dragon/bgo/variables/adc/slope", 30, -1) == -1, "index out of range");
+
+	// several arrays in one batch
+	odb.odbInvalidate();
+	std::vector<std::string> names;
+	names.push_back("/Runinfo/Run number");
+	names.push_back("/Experiment/Name");
+	names.push_back("/dragon/bgo/variables/adc/slope");
+	int fetched = odb.odbPrefetch(names);
+	check(fetched == 32, "prefetch");
+	requests = odb.GetNumRequests();
+	odb.odbReadInt("/Runinfo/Run number", 0, -1);
+	odb.odbReadString("/Experiment/Name", 0, "");
+	odb.odbReadDouble("/dragon/bgo/variables/adc/slope", 29, -1);
+	check(odb.GetNumRequests() == requests, "prefetched values served from the cache");
+
+	// cached values stay until invalidated
+	HttpOdb control(url);
+	control.SetCache(false);
+	check(control.odbReadInt("/Runinfo/Run number", 0, -1) == 100, "uncached read");
+	{
+		// the URL options go first in the query, so this makes a "bump" request
+		HttpOdb bump((std::string(url) + "?cmd=bump").c_str());
+		bump.SetCache(false);
+		bump.odbReadString("/x", 0, "");
+	}
+	check(odb.odbReadInt("/Runinfo/Run number", 0, -1) == 100, "cached value kept");
+	check(control.odbReadInt("/Runinfo/Run number", 0, -1) == 101, "uncached value updated");
+	odb.odbInvalidate();
+	check(odb.odbReadInt("/Runinfo/Run number", 0, -1) == 101, "value updated after odbInvalidate()");
+
+	// HTTP errors give the defaults, and nothing is cached from them
+	std::string missing = url;
+	missing.replace(missing.find("secret.html"), 11, "missing.html");
+	for(int cache = 1; cache >= 0; --cache) {
+		HttpOdb notfound(missing.c_str());
+		notfound.SetCache(cache);
+		const char* mode = cache ? " (cached)" : " (uncached)";
+		check(notfound.odbReadInt("/Runinfo/Run number", 0, -1) == -1,
+					(std::string("404 gives the default int") + mode).c_str());
+		check(!notfound.odbReadBool("/dragon/bgo/enabled", 0, false),
+					(std::string("404 gives the default bool") + mode).c_str());
+		check(!strcmp(notfound.odbReadString("/Experiment/Name", 0, "none"), "none"),
+					(std::string("404 gives the default string") + mode).c_str());
+		check(notfound.odbReadArraySize("/dragon/bgo/variables/adc/slope") == 0,
+					(std::string("404 gives no array size") + mode).c_str());
+		requests = notfound.GetNumRequests();
+		check(notfound.odbReadInt("/Runinfo/Run number", 0, -1) == -1 &&
+					notfound.GetNumRequests() > requests,
+					(std::string("404 not cached") + mode).c_str());
+	}
+
+	// keep-alive: the server closes connections after 50 requests
+	HttpOdb many(url);
+	many.SetCache(false);
+	for(int i=0; i< 120; ++i)
+		many.odbReadInt("/Runinfo/Run number", 0, -1);
+	check(many.GetNumRequests() == 120, "120 uncached requests");
+	check(many.GetNumConnections() == 3, "over 3 keep-alive connections");
+	check(odb.GetNumConnections() == 1, "cached reads over a single connection");
+
+	kill(server, SIGTERM);
+	waitpid(server, 0, 0);
+
+	printf("%d failures\n", gFailures);
+	return gFailures != 0;
+}
@@ -0,0 +1,128 @@
+//
+// Benchmark: file size and write speed of the mid2root output profiles
+// (dragon::OutputProfile). Unpacks the head and tail singles events of a
+// MIDAS file into memory once, then writes them as "t1" and "t3" with each
+// profile and reports a table of the results.
+//
+// Build with `make profilebench`, run as
+// `bin/profilebench <file.mid> [nevents] [profile ...]`; profiles are
+// given as for `mid2root --profile` and default to all built-in ones.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <TFile.h>
+#include <TTree.h>
+#include <TSystem.h>
+#include <TStopwatch.h>
+#include "midas/libMidasInterface/TMidasFile.h"
+#include "utils/OutputProfile.hxx"
+#include "utils/definitions.h"
+#include "Unpack.hxx"
+#include "Dragon.hxx"
+
+struct Result_t {
+	double fileMB;  // size of the output file
+	double dataMB;  // uncompressed size of the trees
+	double seconds; // time to fill, write and close
+};
+
+Result_t write(const dragon::OutputProfile& profile, const char* filename,
+							 const std::vector<dragon::Head>& heads, const std::vector<dragon::Tail>& tails)
+{
+	Result_t result;
+	dragon::Head head;
+	dragon::Tail tail;
+	void* headAddr = &head;
+	void* tailAddr = &tail;
+
+	TStopwatch watch;
+	watch.Start();
+	TFile file(filename, "RECREATE");
+	profile.ApplyTo(&file);
+	TTree* t1 = new TTree("t1", "Head singles event.");
+	TTree* t3 = new TTree("t3", "Tail singles event.");
+	profile.MakeBranch(t1, "head", "dragon::Head", &headAddr);
+	profile.MakeBranch(t3, "tail", "dragon::Tail", &tailAddr);
+	profile.ApplyTo(t1);
+	profile.ApplyTo(t3);
+
+	for(size_t i=0; i< heads.size(); ++i) {
+		head = heads[i];
+		t1->Fill();
+	}
+	for(size_t i=0; i< tails.size(); ++i) {
+		tail = tails[i];
+		t3->Fill();
+	}
+	file.Write();
+	result.dataMB = (t1->GetTotBytes() + t3->GetTotBytes()) / 1e6;
+	file.Close();
+	watch.Stop();
+	result.seconds = watch.RealTime();
+
+	FileStat_t stat;
+	gSystem->GetPathInfo(filename, stat);
+	result.fileMB = stat.fSize / 1e6;
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2) {
+		fprintf(stderr, "usage: profilebench <file.mid> [nevents] [profile ...]\n");
+		return 1;
+	}
+	const size_t nevents = argc > 2 ? atoi(argv[2]) : 20000;
+	std::vector<std::string> specs(argv + (argc > 3 ? 3 : argc), argv + argc);
+	if(specs.empty()) specs = dragon::OutputProfile::GetBuiltinNames();
+
+	std::vector<dragon::OutputProfile> profiles(specs.size());
+	for(size_t i=0; i< specs.size(); ++i)
+		if(!dragon::OutputProfile::Get(specs[i], profiles[i])) return 1;
+
+	//
+	// Unpack singles events into memory
+	TMidasFile fin;
+	if(!fin.Open(argv[1])) {
+		fprintf(stderr, "Couldn't open \"%s\": %s\n", argv[1], fin.GetLastError());
+		return 1;
+	}
+	dragon::Head head;
+	dragon::Tail tail;
+	dragon::Coinc coinc;
+	dragon::Epics epics;
+	dragon::Scaler headScaler, tailScaler, auxScaler;
+	dragon::RunParameters runpar;
+	tstamp::Diagnostics tsdiag;
+	dragon::Unpacker unpack(&head, &tail, &coinc, &epics, &headScaler, &tailScaler, &auxScaler, &runpar, &tsdiag, true);
+	unpack.HandleBor(argv[1]);
+
+	std::vector<dragon::Head> heads;
+	std::vector<dragon::Tail> tails;
+	TMidasEvent event;
+	while(heads.size() + tails.size() < nevents && fin.Read(&event)) {
+		std::vector<int32_t> which = unpack.UnpackMidasEvent(event.GetEventHeader(), event.GetData());
+		for(size_t i=0; i< which.size(); ++i) {
+			if(which[i] == DRAGON_HEAD_EVENT) heads.push_back(head);
+			if(which[i] == DRAGON_TAIL_EVENT) tails.push_back(tail);
+		}
+	}
+	printf("%lu head and %lu tail events from %s\n\n", (unsigned long)heads.size(), (unsigned long)tails.size(), argv[1]);
+
+	//
+	// Write with each profile
+	const TString filename = TString(gSystem->TempDirectory()) + "/profilebench.root";
+	printf("%-12s %-8s %6s %10s %10s %8s %12s\n", "profile", "algo", "level", "file [MB]", "data [MB]", "ratio", "write [MB/s]");
+	for(size_t i=0; i< profiles.size(); ++i) {
+		Result_t r = write(profiles[i], filename.Data(), heads, tails);
+		static const char* const algorithms[] = { "inherit", "zlib", "lzma", "old", "lz4", "zstd" };
+		printf("%-12s %-8s %6d %10.2f %10.2f %8.2f %12.1f\n",
+					 profiles[i].fName.c_str(), algorithms[profiles[i].fAlgorithm], profiles[i].fLevel,
+					 r.fileMB, r.dataMB, r.dataMB / r.fileMB, r.dataMB / r.seconds);
+	}
+	gSystem->Unlink(filename.Data());
+
+	return 0;
+}